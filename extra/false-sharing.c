@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+// Microbenchmark for the AppState layout: the audio thread keeps storing in_size while the render thread keeps
+// updating skip_c and curr_time. Packed, both land on the same cache line (old AppState). Split, each thread owns
+// its own line (new AppState). Run with at least 2 cores, on one core there is no contention to show
+
+#define CACHE_LINE 64
+#define ITERATIONS 100000000UL
+
+typedef struct {
+    float * in1;
+    size_t in_size;          // audio thread
+    unsigned int skip_c;     // render thread
+    float curr_time;         // render thread
+} Packed;
+
+typedef struct {
+    struct {
+        float * in1;
+        size_t in_size;      // audio thread
+    } __attribute__((aligned(CACHE_LINE))) capture;
+    struct {
+        unsigned int skip_c; // render thread
+        float curr_time;     // render thread
+    } __attribute__((aligned(CACHE_LINE))) render;
+} Split;
+
+static Packed packed __attribute__((aligned(CACHE_LINE)));
+static Split split;
+
+static void * packed_producer(void * arg)
+{
+    (void) arg;
+    volatile size_t * in_size = &packed.in_size;
+    for (size_t i = 0; i < ITERATIONS; i++) *in_size = i;
+    return NULL;
+}
+
+static void * packed_consumer(void * arg)
+{
+    (void) arg;
+    volatile unsigned int * skip_c = &packed.skip_c;
+    volatile float * curr_time = &packed.curr_time;
+    for (size_t i = 0; i < ITERATIONS; i++) { *skip_c += 1; *curr_time += 1.0f; }
+    return NULL;
+}
+
+static void * split_producer(void * arg)
+{
+    (void) arg;
+    volatile size_t * in_size = &split.capture.in_size;
+    for (size_t i = 0; i < ITERATIONS; i++) *in_size = i;
+    return NULL;
+}
+
+static void * split_consumer(void * arg)
+{
+    (void) arg;
+    volatile unsigned int * skip_c = &split.render.skip_c;
+    volatile float * curr_time = &split.render.curr_time;
+    for (size_t i = 0; i < ITERATIONS; i++) { *skip_c += 1; *curr_time += 1.0f; }
+    return NULL;
+}
+
+double run(void * (*producer)(void *), void * (*consumer)(void *))
+{
+    struct timespec start, end;
+    pthread_t p, c;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&p, NULL, producer, NULL);
+    pthread_create(&c, NULL, consumer, NULL);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(void)
+{
+    const double packed_time = run(packed_producer, packed_consumer);
+    const double split_time = run(split_producer, split_consumer);
+
+    printf("packed (same line):  %6.3f s\n", packed_time);
+    printf("split  (own lines):  %6.3f s\n", split_time);
+    printf("speedup:             %6.2fx\n", packed_time / split_time);
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "../src/fastmath.h"
+
+#define PI 3.14159265358979323846
+
+// Max error of the fast paths against libm (double precision reference)
+//   $ make fastmath_error && ./build/fastmath-error.out
+int main(void)
+{
+    double log2_err = 0, log_err = 0, db_err = 0;
+    float worst = 0;
+
+    // Geometric sweep over the range power spectra live in
+    for (double x = 1e-30; x < 1e30; x *= 1.0000173) {
+        const float f = (float) x;
+        const double ref = log2((double) f);
+
+        const double e = fabs(fast_log2f(f) - ref);
+        if (e > log2_err) { log2_err = e; worst = f; }
+
+        const double el = fabs(fast_logf(f) - log((double) f));
+        if (el > log_err) log_err = el;
+
+        const double ed = fabs(fast_power_db(f) - 10.0 * log10((double) f));
+        if (ed > db_err) db_err = ed;
+    }
+
+    printf("fast_log2f     max abs error: %.3g (at %g)\n", log2_err, worst);
+    printf("fast_logf      max abs error: %.3g\n", log_err);
+    printf("fast_power_db  max abs error: %.3g dB\n", db_err);
+
+    // Tables vs libm single precision calls used by the slow paths
+    const size_t N = 16384;
+    static float complex tw[16384 / 2];
+    static float w[16384];
+    fast_twiddles(tw, N);
+    fast_hann(w, N);
+
+    double tw_err = 0, w_err = 0;
+    for (size_t k = 0; k < N / 2; k++) {
+        const double angle = -2.0 * PI * (double) k / N;
+        const double e = cabs(tw[k] - (cos(angle) + sin(angle) * I));
+        if (e > tw_err) tw_err = e;
+    }
+    for (size_t i = 0; i < N; i++) {
+        const double e = fabs(w[i] - (0.5 - 0.5 * cos(2 * PI * (double) i / (N - 1))));
+        if (e > w_err) w_err = e;
+    }
+
+    printf("fast_twiddles  max abs error: %.3g\n", tw_err);
+    printf("fast_hann      max abs error: %.3g\n", w_err);
+
+    return 0;
+}
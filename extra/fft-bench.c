@@ -0,0 +1,90 @@
+#include <complex.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/arena.h"
+#include "../src/clock.h"
+#include "../src/fastmath.h"
+#include "../src/fft.h"
+
+// Cost of every FFT variant from cache resident sizes to ones that stream from memory: the recursive radix-2 fft()
+// of the analysis, the plans with the recursive and the Stockham kernels, and FRAMES back to back frames one plan
+// call at a time (loop) or all in one fft_batch_real() (batch), both per frame. Working set of a plan is about 24
+// bytes per point (input, two complex buffers and the twiddles): 1024 fits L1, 16384 L2, 2^18 and up only L3
+//   $ make fft_bench && ./build/fft-bench.out
+
+#define MAX_N ((size_t) 1 << 20)
+
+#define FFT -1                 // fft()
+#define LOOP FFT_KERNEL_COUNT  // After the plan kernels: fft_plan_real() on each frame of a batch
+#define BATCH (LOOP + 1)       // fft_batch_real() on the same frames
+#define FRAMES 64              // Frames of a batch (fewer when they would not fit in MAX_N)
+
+// Nanoseconds per n log2 n of one transform, best of 5 rounds of about 20M n log2 n each
+static double bench(size_t n, const float * x, int kernel)
+{
+    static float in[MAX_N];
+    static float complex out[MAX_N];
+    Arena arena = { 0 };
+    FftPlan plan;
+    FftBatch batch;
+    if (! arena_reserve(&arena, fft_plan_arena_size(n) + ARENA_ALIGN(n / 2 * sizeof(float complex)) +
+                                    fft_batch_arena_size(n)) ||
+        ! fft_plan_init(&plan, &arena, n) || ! fft_batch_init(&batch, &arena, &plan)) {
+        printf("could not plan %zu\n", n);
+        exit(1);
+    }
+    float complex * tw = arena_alloc(&arena, n / 2 * sizeof(float complex));
+    fast_twiddles(tw, n);
+    if (kernel >= 0 && kernel < FFT_KERNEL_COUNT) fft_plan_use(&plan, (FftKernel) kernel);
+
+    const size_t frames = kernel < LOOP ? 1 : MAX_N / n < FRAMES ? MAX_N / n : FRAMES;
+    const double nlogn = n * log2((double) n) * frames;
+    const int iterations = (int) (20e6 / nlogn) + 1;
+    double best = 1e30;
+    for (int round = 0; round < 5; round++) {
+        const double start = clock_seconds();
+        for (int i = 0; i < iterations; i++) {
+            if (kernel == FFT) {
+                for (size_t j = 0; j < n; j++) in[j] = x[j];
+                fft(in, 1, out, n, tw);
+            } else if (kernel == LOOP) {
+                for (size_t f = 0; f < frames; f++) fft_plan_real(&plan, x + f * n, out + f * n);
+            } else if (kernel == BATCH) {
+                fft_batch_real(&batch, x, frames, out);
+            } else {
+                fft_plan_real(&plan, x, out);
+            }
+        }
+        const double t = (clock_seconds() - start) / iterations * 1e9 / nlogn;
+        if (t < best) best = t;
+    }
+    arena_free(&arena);
+    return best;
+}
+
+int main(void)
+{
+    static float x[MAX_N];
+    srand(1);
+    for (size_t i = 0; i < MAX_N; i++) x[i] = (float) rand() / RAND_MAX * 2.0f - 1.0f;
+
+    const struct { size_t n; const char * where; } sizes[] = {
+        { 1024, "L1" }, { 2048, "L1" }, { 4800, "L1/L2" }, { 16384, "L2" }, { 65536, "L2" },
+        { (size_t) 1 << 18, "L3" }, { (size_t) 1 << 20, "L3" },
+    };
+    printf("ns per n log2 n        fft()   recursive    stockham        loop       batch\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        const size_t n = sizes[i].n;
+        printf("n = %7zu %-6s", n, sizes[i].where);
+        if ((n & (n - 1)) == 0) {
+            printf("  %8.2f", bench(n, x, FFT));
+        } else {
+            printf("  %8s", "-");
+        }
+        for (int kernel = 0; kernel <= BATCH; kernel++) printf("  %10.2f", bench(n, x, kernel));
+        printf("\n");
+    }
+    return 0;
+}
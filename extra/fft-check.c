@@ -0,0 +1,138 @@
+#include <complex.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/arena.h"
+#include "../src/fastmath.h"
+#include "../src/fft.h"
+#include "../src/sixstep.h"
+
+#define PI 3.14159265358979323846
+#define MAX_N 16384
+
+// Every FFT plan kernel, the radix-2 fft(), batches and the six step transform on a pool against the O(n^2) DFT in
+// double precision (timings: extra/fft-bench.c and extra/sixstep-bench.c)
+//   $ make fft_check && ./build/fft-check.out
+
+#define FFT -1                    // fft(), powers of 2 only
+#define BATCH FFT_KERNEL_COUNT    // After the plan kernels
+#define SIXSTEP (BATCH + 1)
+#define SIXSTEP_WORKERS 3         // Not a divisor of the task counts, the slices come out uneven
+
+static Pool pool;
+
+static const char * name(int kernel)
+{
+    if (kernel == FFT) return "fft";
+    if (kernel == BATCH) return "batch";
+    if (kernel == SIXSTEP) return "sixstep";
+    return fft_kernel_name((FftKernel) kernel);
+}
+
+// Max error of scale * ref over the bins, relative to the largest reference bin
+static double error(const float complex * out, const double complex * ref, size_t n, float scale)
+{
+    double err = 0, peak = 0;
+    for (size_t k = 0; k < n; k++) {
+        const double e = cabs(out[k] - scale * ref[k]);
+        if (e > err) err = e;
+        if (cabs(scale * ref[k]) > peak) peak = cabs(scale * ref[k]);
+    }
+    return err / peak;
+}
+
+// Frame f of a batch is x * (f + 1), so a frame read from the wrong lane shows up. Two full groups and a partial one
+static double check_batch(const FftPlan * plan, Arena * arena, const float * x, const double complex * ref)
+{
+    const size_t n = plan->n;
+    FftBatch batch;
+    if (! fft_batch_init(&batch, arena, plan)) exit(1);
+    const size_t count = 2 * FFT_BATCH_LANES + FFT_BATCH_LANES / 2 + 1;
+    float * frames = malloc(count * n * sizeof(float));
+    float complex * spectra = malloc(count * n * sizeof(float complex));
+    if (frames == NULL || spectra == NULL) exit(1);
+    for (size_t f = 0; f < count; f++) {
+        for (size_t i = 0; i < n; i++) frames[f * n + i] = x[i] * (float) (f + 1);
+    }
+    fft_batch_real(&batch, frames, count, spectra);
+
+    double worst = 0;
+    for (size_t f = 0; f < count; f++) {
+        const double err = error(spectra + f * n, ref, n, (float) (f + 1));
+        if (err > worst) worst = err;
+    }
+    free(frames);
+    free(spectra);
+    return worst;
+}
+
+// Max error over the bins relative to the largest reference bin
+static double check(size_t n, const float * x, int kernel)
+{
+    static double complex ref[MAX_N];
+    static float complex out[MAX_N];
+    static float in[MAX_N];
+    for (size_t k = 0; k < n; k++) {
+        double complex sum = 0;
+        for (size_t j = 0; j < n; j++) sum += x[j] * cexp(-2.0 * I * PI * (double) ((j * k) % n) / n);
+        ref[k] = sum;
+    }
+
+    Arena arena = { 0 };
+    FftPlan plan;
+    SixStep six;
+    const size_t size = fft_plan_arena_size(n) + ARENA_ALIGN(n / 2 * sizeof(float complex)) +
+                        sixstep_arena_size(n, pool.workers) + fft_batch_arena_size(n);
+    if (! arena_reserve(&arena, size) || ! fft_plan_init(&plan, &arena, n) || ! sixstep_init(&six, &arena, n, &pool)) {
+        printf("n = %zu: could not plan\n", n);
+        exit(1);
+    }
+    if (kernel == BATCH) {
+        const double err = check_batch(&plan, &arena, x, ref);
+        arena_free(&arena);
+        return err;
+    } else if (kernel == SIXSTEP) {
+        if (! sixstep_real(&six, x, out)) {
+            printf("n = %zu: six-step could not submit\n", n);
+            exit(1);
+        }
+    } else if (kernel == FFT) {
+        float complex * tw = arena_alloc(&arena, n / 2 * sizeof(float complex));
+        fast_twiddles(tw, n);
+        for (size_t i = 0; i < n; i++) in[i] = x[i];
+        fft(in, 1, out, n, tw);
+    } else {
+        fft_plan_use(&plan, (FftKernel) kernel);
+        fft_plan_real(&plan, x, out);
+    }
+
+    arena_free(&arena);
+    return error(out, ref, n, 1.0f);
+}
+
+int main(void)
+{
+    static float x[MAX_N];
+    srand(1);
+    for (size_t i = 0; i < MAX_N; i++) x[i] = (float) rand() / RAND_MAX * 2.0f - 1.0f;
+    if (! pool_init(&pool, SIXSTEP_WORKERS)) return 1;
+
+    // Every radix alone and mixed, powers of 2, the 100 ms windows and primes (Bluestein)
+    const size_t sizes[] = { 1, 2, 3, 4, 5, 6, 8, 9, 12, 15, 16, 25, 27, 30, 32, 60, 64, 81, 100, 125, 128, 256, 480,
+                             625, 882, 1024, 1323, 4096, 4410, 4800, 7, 11, 13, 97, 101, 1021, 4801, 4799 };
+    double worst = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        const size_t n = sizes[i];
+        printf("n = %5zu  max rel error", n);
+        for (int kernel = (n & (n - 1)) == 0 ? FFT : 0; kernel <= SIXSTEP; kernel++) {
+            const double err = check(n, x, kernel);
+            if (err > worst) worst = err;
+            printf("  %s %.2e%s", name(kernel), err, err > 1e-5 ? " FAIL" : "");
+        }
+        printf("\n");
+    }
+    printf("worst %.2e\n", worst);
+    pool_free(&pool);
+    return worst > 1e-5 ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/fft.h"
+
+// Generate the straight line FFT codelets (see src/fft.h) as C: every butterfly of a radix 4 (radix 2 on top for
+// 8 and 32) decimation in time unrolled, the twiddles folded in as constants and the trivial ones (1, -i, the
+// multiples of pi/4) turned into sign flips and adds. The real input variants drop every operation on a zero
+// imaginary part
+//   $ ./build/fft-gen.out bin/fft_codelets.c
+
+// One real value: a temporary (maybe negated) or a known zero
+typedef struct {
+    int id;
+    bool neg;
+    bool zero;
+} Ref;
+
+typedef struct {
+    Ref re;
+    Ref im;
+} Value;
+
+static FILE * out;
+static int temps;
+
+static const Ref ZERO = { .zero = true };
+
+static Ref neg(Ref a)
+{
+    if (! a.zero) a.neg = ! a.neg;
+    return a;
+}
+
+static Ref temp(void)
+{
+    return (Ref) { .id = temps++ };
+}
+
+// a + b, a negated result costs nothing: it becomes a sign flip where it is used
+static Ref add(Ref a, Ref b)
+{
+    if (a.zero) return b;
+    if (b.zero) return a;
+    Ref t = temp();
+    if (a.neg && b.neg) {
+        fprintf(out, "    const float t%d = t%d + t%d;\n", t.id, a.id, b.id);
+        t.neg = true;
+    } else if (a.neg) {
+        fprintf(out, "    const float t%d = t%d - t%d;\n", t.id, b.id, a.id);
+    } else {
+        fprintf(out, "    const float t%d = t%d %c t%d;\n", t.id, a.id, b.neg ? '-' : '+', b.id);
+    }
+    return t;
+}
+
+static Ref sub(Ref a, Ref b)
+{
+    return add(a, neg(b));
+}
+
+static Ref mulc(Ref a, double c)
+{
+    if (a.zero || c == 0.0) return ZERO;
+    if (c == 1.0) return a;
+    if (c == -1.0) return neg(a);
+    Ref t = temp();
+    fprintf(out, "    const float t%d = t%d * %.9gf;\n", t.id, a.id, fabs(c));
+    t.neg = a.neg != (c < 0.0);
+    return t;
+}
+
+// W_n^k = e^(-2*pi*i*k/n), exact on the multiples of pi/4 so mul() can spot them
+static void twiddle(size_t n, size_t k, double * wr, double * wi, bool * diagonal)
+{
+    const double h = 0.70710678118654752440;
+    static const double eighths[8][2] = { { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, -1 },
+                                          { -1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    *diagonal = false;
+    if ((8 * k) % n == 0) {
+        const size_t e = (8 * k / n) % 8;
+        *diagonal = e % 2 == 1;
+        *wr = eighths[e][0] * (*diagonal ? h : 1.0);
+        *wi = eighths[e][1] * (*diagonal ? h : 1.0);
+        return;
+    }
+    const double angle = -2.0 * 3.14159265358979323846 * (double) k / (double) n;
+    *wr = cos(angle);
+    *wi = sin(angle);
+}
+
+static Value mul(Value x, size_t n, size_t k)
+{
+    double wr, wi;
+    bool diagonal;
+    twiddle(n, k, &wr, &wi, &diagonal);
+    if (wi == 0.0) return (Value) { mulc(x.re, wr), mulc(x.im, wr) };
+    if (wr == 0.0) return (Value) { mulc(x.im, -wi), mulc(x.re, wi) };
+    if (diagonal) {
+        // wi = +-wr: two adds and two products instead of four products
+        if (wi == wr) return (Value) { mulc(sub(x.re, x.im), wr), mulc(add(x.re, x.im), wr) };
+        return (Value) { mulc(add(x.re, x.im), wr), mulc(sub(x.im, x.re), wr) };
+    }
+    return (Value) { sub(mulc(x.re, wr), mulc(x.im, wi)), add(mulc(x.re, wi), mulc(x.im, wr)) };
+}
+
+static Value vadd(Value a, Value b)
+{
+    return (Value) { add(a.re, b.re), add(a.im, b.im) };
+}
+
+static Value vsub(Value a, Value b)
+{
+    return (Value) { sub(a.re, b.re), sub(a.im, b.im) };
+}
+
+// -i * a
+static Value vmul_mi(Value a)
+{
+    return (Value) { a.im, neg(a.re) };
+}
+
+// Transform of x[0], x[stride], ... (n of them) into y
+static void gen(const Value * x, size_t stride, size_t n, Value * y)
+{
+    if (n == 1) {
+        y[0] = x[0];
+        return;
+    }
+
+    // Radix 2 only where 4 does not divide n (8 = 2 * 4, 32 = 2 * 16)
+    const size_t p = n % 4 == 0 ? 4 : 2;
+    const size_t m = n / p;
+    Value * sub_y = malloc(n * sizeof(Value));
+    for (size_t q = 0; q < p; q++) gen(x + q * stride, stride * p, m, sub_y + q * m);
+
+    for (size_t k = 0; k < m; k++) {
+        if (p == 2) {
+            const Value e = sub_y[k];
+            const Value o = mul(sub_y[m + k], n, k);
+            y[k] = vadd(e, o);
+            y[k + m] = vsub(e, o);
+            continue;
+        }
+        const Value a0 = sub_y[k];
+        const Value a1 = mul(sub_y[m + k], n, k);
+        const Value a2 = mul(sub_y[2 * m + k], n, 2 * k);
+        const Value a3 = mul(sub_y[3 * m + k], n, 3 * k);
+        const Value t0 = vadd(a0, a2), t1 = vsub(a0, a2);
+        const Value t2 = vadd(a1, a3), t3 = vmul_mi(vsub(a1, a3));
+        y[k] = vadd(t0, t2);
+        y[k + m] = vadd(t1, t3);
+        y[k + 2 * m] = vsub(t0, t2);
+        y[k + 3 * m] = vsub(t1, t3);
+    }
+    free(sub_y);
+}
+
+static void store(const char * part, size_t k, Ref r)
+{
+    fprintf(out, "    %s out[%zu * os] = ", part, k);
+    if (r.zero) {
+        fprintf(out, "0.0f;\n");
+    } else {
+        fprintf(out, "%st%d;\n", r.neg ? "-" : "", r.id);
+    }
+}
+
+static void codelet(size_t n, bool real)
+{
+    Value * x = malloc(n * sizeof(Value));
+    Value * y = malloc(n * sizeof(Value));
+    temps = 0;
+
+    fprintf(out, "static void codelet%s%zu(const float%s * in, size_t is, float complex * out, size_t os)\n{\n",
+            real ? "_real" : "", n, real ? "" : " complex");
+    for (size_t j = 0; j < n; j++) {
+        x[j].re = temp();
+        if (real) {
+            x[j].im = ZERO;
+            fprintf(out, "    const float t%d = in[%zu * is];\n", x[j].re.id, j);
+        } else {
+            x[j].im = temp();
+            fprintf(out, "    const float t%d = crealf(in[%zu * is]), t%d = cimagf(in[%zu * is]);\n", x[j].re.id, j,
+                    x[j].im.id, j);
+        }
+    }
+    gen(x, 1, n, y);
+    for (size_t k = 0; k < n; k++) {
+        store("__real__", k, y[k].re);
+        store("__imag__", k, y[k].im);
+    }
+    fprintf(out, "}\n\n");
+
+    free(x);
+    free(y);
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <out.c>\n", argv[0]);
+        return 1;
+    }
+    out = fopen(argv[1], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by extra/fft-gen.c, do not edit\n\n");
+    fprintf(out, "#include \"fft.h\"\n\n");
+    for (size_t n = 2; n <= FFT_CODELET_MAX; n *= 2) {
+        codelet(n, false);
+        codelet(n, true);
+    }
+
+    fprintf(out, "const FftCodelet fft_codelets[FFT_CODELET_LOG2 + 1] = {\n    NULL,\n");
+    for (size_t n = 2; n <= FFT_CODELET_MAX; n *= 2) fprintf(out, "    codelet%zu,\n", n);
+    fprintf(out, "};\n\n");
+    fprintf(out, "const FftCodeletReal fft_codelets_real[FFT_CODELET_LOG2 + 1] = {\n    NULL,\n");
+    for (size_t n = 2; n <= FFT_CODELET_MAX; n *= 2) fprintf(out, "    codelet_real%zu,\n", n);
+    fprintf(out, "};\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Could not write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
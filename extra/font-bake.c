@@ -0,0 +1,65 @@
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../src/font.h"
+
+// Rasterize the UI font once at build time and write the atlas and metrics as C (see src/font.h)
+//   $ ./build/font-bake.out resources/fonts/NotoSans-Regular.ttf bin/font_atlas.c
+int main(int argc, char ** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <font.ttf> <out.c>\n", argv[0]);
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    unsigned int size = 0;
+    unsigned char * ttf = LoadFileData(argv[1], &size);
+    if (ttf == NULL) return 1;
+
+    // Same calls LoadFontEx makes, minus the texture upload
+    GlyphInfo * glyphs = LoadFontData(ttf, (int) size, FONT_SIZE, NULL, FONT_GLYPHS, FONT_DEFAULT);
+    if (glyphs == NULL) return 1;
+    Rectangle * recs = NULL;
+    Image atlas = GenImageFontAtlas(glyphs, &recs, FONT_GLYPHS, FONT_SIZE, FONT_PADDING, 0);
+    ImageFormat(&atlas, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA);
+
+    FILE * out = fopen(argv[2], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by extra/font-bake.c from %s, do not edit\n\n", GetFileName(argv[1]));
+    fprintf(out, "#include \"font.h\"\n\n");
+    fprintf(out, "const int font_atlas_width = %d;\n", atlas.width);
+    fprintf(out, "const int font_atlas_height = %d;\n\n", atlas.height);
+
+    // Only the coverage: the color channel is always white
+    const unsigned char * pixels = atlas.data;
+    const int count = atlas.width * atlas.height;
+    fprintf(out, "const unsigned char font_atlas_alpha[] = {");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, i % 24 == 0 ? "\n    %d," : "%d,", pixels[2 * i + 1]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "const FontAtlasGlyph font_atlas_glyphs[FONT_GLYPHS] = {\n");
+    for (int i = 0; i < FONT_GLYPHS; i++) {
+        fprintf(out, "    { %d, %d, %d, %d, %d, %d, %d, %d },\n", glyphs[i].value, glyphs[i].offsetX,
+                glyphs[i].offsetY, glyphs[i].advanceX, (int) recs[i].x, (int) recs[i].y, (int) recs[i].width,
+                (int) recs[i].height);
+    }
+    fprintf(out, "};\n");
+
+    const bool ok = fclose(out) == 0;
+    printf("Baked %d glyphs at %dpx into a %dx%d atlas: %s\n", FONT_GLYPHS, FONT_SIZE, atlas.width, atlas.height,
+           argv[2]);
+
+    UnloadImage(atlas);
+    UnloadFontData(glyphs, FONT_GLYPHS);
+    MemFree(recs);
+    UnloadFileData(ttf);
+    return ok ? 0 : 1;
+}
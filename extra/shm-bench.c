@@ -0,0 +1,94 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/clock.h"
+#include "../src/publish.h"
+
+// Throughput of the shared memory spectrum ring with several concurrent readers. One thread publishes frames as
+// fast as it can, every reader maps the segment on its own (as a separate process would) and reads the latest frame
+// in a loop. Each frame is filled with its own counter so a torn copy (levels of two frames) is caught. Run with a
+// core per thread: on fewer, a reader only runs while the publisher does not and sees one frame per time slice
+//   $ make shm_bench && ./build/shm-bench.out [readers] [seconds]
+
+#define NAME "musializer-bench"
+#define BANDS 128
+
+typedef struct {
+    pthread_t thread;
+    unsigned long long frames;   // Frames read
+    unsigned long long retries;  // Copies thrown away by the seqlock
+    unsigned long long torn;     // Copies that passed the seqlock with mixed frames (must stay 0)
+} Reader;
+
+static volatile int running = 1;
+
+static void * read_loop(void * arg)
+{
+    Reader * r = arg;
+    PublishReader reader;
+    if (! publish_attach(&reader, NAME)) {
+        fprintf(stderr, "could not attach\n");
+        return NULL;
+    }
+
+    PublishSlot slot;
+    float levels[BANDS];
+    while (running) {
+        if (! publish_read(&reader, &slot, levels, BANDS)) continue;
+        r->frames++;
+        const float expect = (float) (slot.frame & 0xFFFFF);
+        for (int i = 0; i < BANDS; i++) {
+            if (levels[i] != expect || slot.position != slot.frame * 512) {
+                r->torn++;
+                break;
+            }
+        }
+    }
+    r->retries = reader.retries;
+    publish_detach(&reader);
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 4;
+    const double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+
+    Publisher pub;
+    if (! publish_open(&pub, NAME, BANDS)) return 1;
+
+    Reader * readers = calloc(count, sizeof(Reader));
+    for (int i = 0; i < count; i++) pthread_create(&readers[i].thread, NULL, read_loop, &readers[i]);
+
+    const double start = clock_seconds();
+    unsigned long long published = 0;
+    while (clock_seconds() - start < seconds) {
+        for (int k = 0; k < 1024; k++) {
+            PublishSlot * slot = publish_begin(&pub);
+            float * levels = publish_levels(slot);
+            const float value = (float) (slot->frame & 0xFFFFF);
+            for (int i = 0; i < BANDS; i++) levels[i] = value;
+            slot->position = slot->frame * 512;
+            slot->sample_rate = 48000;
+            slot->bands = BANDS;
+            publish_end(&pub, slot);
+        }
+        published += 1024;
+    }
+    const double wall = clock_seconds() - start;
+    running = 0;
+
+    printf("published %.2f M frames/s (%d bands, %d readers)\n", published / wall / 1e6, BANDS, count);
+    unsigned long long torn = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_join(readers[i].thread, NULL);
+        printf("reader %d: %llu frames (%.1f k/s), %llu retries, %llu torn\n", i, readers[i].frames,
+               readers[i].frames / wall / 1e3, readers[i].retries, readers[i].torn);
+        torn += readers[i].torn;
+    }
+
+    free(readers);
+    publish_close(&pub);
+    return torn == 0 ? 0 : 1;
+}
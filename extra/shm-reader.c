@@ -0,0 +1,42 @@
+#define _DEFAULT_SOURCE // usleep
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "../src/publish.h"
+
+#define MAX_BANDS 256
+
+// Smallest consumer of the published spectrum: prints the bars of the latest frame as a text row
+//   $ ./build/dev.out track.mp3 --publish musializer
+//   $ make shm_reader && ./build/shm-reader.out musializer
+int main(int argc, char ** argv)
+{
+    const char * name = argc > 1 ? argv[1] : "musializer";
+    const char ramp[] = " .:-=+*#%@";
+
+    PublishReader reader;
+    while (! publish_attach(&reader, name)) {
+        fprintf(stderr, "waiting for /%s...\n", name);
+        sleep(1);
+    }
+
+    PublishSlot slot;
+    float levels[MAX_BANDS];
+    for (;;) {
+        if (! publish_read(&reader, &slot, levels, MAX_BANDS)) {
+            usleep(5000); // Polling at 200 Hz is plenty for 15 frames per second
+            continue;
+        }
+
+        char row[MAX_BANDS + 1];
+        for (uint32_t i = 0; i < slot.bands; i++) {
+            float x = levels[i] < 0.0f ? 0.0f : levels[i] > 1.0f ? 1.0f : levels[i];
+            row[i] = ramp[(int) (x * (sizeof(ramp) - 2))];
+        }
+        row[slot.bands] = '\0';
+        printf("%8.2f s %5.1f BPM %c |%s|\n", (double) slot.position / slot.sample_rate, slot.bpm,
+               slot.beat_phase < 0.1f ? '*' : ' ', row);
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,86 @@
+#include <complex.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/arena.h"
+#include "../src/clock.h"
+#include "../src/fft.h"
+#include "../src/pool.h"
+#include "../src/sixstep.h"
+
+// Large transforms for offline spectra: one Stockham plan on one thread against the six step transform on pools of
+// 1 to 8 workers. Speedup is against the six step on 1 worker, so it only measures the scaling (it needs as many
+// free cores as workers: on a smaller machine the extra workers just take turns)
+//   $ make sixstep_bench && ./build/sixstep-bench.out
+
+#define MIN_LOG2 18
+#define MAX_LOG2 22
+#define MAX_N ((size_t) 1 << MAX_LOG2)
+#define ROUNDS 5
+
+// Best of ROUNDS, in milliseconds per transform. workers == 0 is the single threaded plan
+static double bench(size_t n, const float * x, float complex * out, size_t workers)
+{
+    Arena arena = { 0 };
+    Pool pool = { 0 };
+    FftPlan plan;
+    SixStep six;
+    if (workers == 0) {
+        if (! arena_reserve(&arena, fft_plan_arena_size(n)) || ! fft_plan_init(&plan, &arena, n)) exit(1);
+    } else {
+        if (! pool_init(&pool, workers)) exit(1);
+        if (! arena_reserve(&arena, sixstep_arena_size(n, workers)) || ! sixstep_init(&six, &arena, n, &pool)) exit(1);
+    }
+
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        const double start = clock_seconds();
+        if (workers == 0) {
+            fft_plan_real(&plan, x, out);
+        } else {
+            if (! sixstep_real(&six, x, out)) exit(1);
+        }
+        const double t = (clock_seconds() - start) * 1e3;
+        if (t < best) best = t;
+    }
+
+    if (workers > 0) pool_free(&pool);
+    arena_free(&arena);
+    return best;
+}
+
+int main(void)
+{
+    static float x[MAX_N];
+    static float complex ref[MAX_N];
+    static float complex out[MAX_N];
+    const size_t workers[] = { 1, 2, 4, 8 };
+    srand(1);
+    for (size_t i = 0; i < MAX_N; i++) x[i] = (float) rand() / RAND_MAX * 2.0f - 1.0f;
+
+    printf("ms per transform   stockham");
+    for (size_t w = 0; w < sizeof(workers) / sizeof(workers[0]); w++) printf("   sixstep x%zu", workers[w]);
+    printf("   max rel diff\n");
+
+    for (size_t log2n = MIN_LOG2; log2n <= MAX_LOG2; log2n++) {
+        const size_t n = (size_t) 1 << log2n;
+        printf("n = 2^%zu %9s %9.2f", log2n, "", bench(n, x, ref, 0));
+
+        double first = 0;
+        for (size_t w = 0; w < sizeof(workers) / sizeof(workers[0]); w++) {
+            const double t = bench(n, x, out, workers[w]);
+            if (w == 0) first = t;
+            printf("  %6.2f %4.1fx", t, first / t);
+        }
+
+        // Same bins as the plan (within float rounding)
+        double diff = 0, peak = 0;
+        for (size_t k = 0; k < n; k++) {
+            if (cabsf(out[k] - ref[k]) > diff) diff = cabsf(out[k] - ref[k]);
+            if (cabsf(ref[k]) > peak) peak = cabsf(ref[k]);
+        }
+        printf("  %12.2e\n", diff / peak);
+    }
+    return 0;
+}
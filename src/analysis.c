@@ -0,0 +1,133 @@
+#include <math.h>
+
+#include "analysis.h"
+#include "fastmath.h"
+#include "fft.h"
+#include "planner.h"
+
+size_t analysis_bands(size_t n, float lowf, float step)
+{
+    size_t m = 0; // M frequencies
+    for (float f = lowf; (size_t) f < n/2; f = ceilf(f * step)) m++;
+    return m;
+}
+
+size_t analysis_arena_size(size_t n, float lowf, float step)
+{
+    const size_t m = analysis_bands(n, lowf, step);
+    return fft_plan_arena_size(n)                       // plan
+         + ARENA_ALIGN(n * sizeof(float))               // in
+         + ARENA_ALIGN(n * sizeof(float complex))       // out
+         + ARENA_ALIGN(n / 2 * sizeof(float))           // power
+         + ARENA_ALIGN(n / 2 * sizeof(float complex))   // tw
+         + ARENA_ALIGN(n * sizeof(float))               // window
+         + ARENA_ALIGN(m * sizeof(float));              // bands
+}
+
+bool analysis_init(Analysis * analysis, Arena * arena, size_t n, float lowf, float step)
+{
+    const size_t m = analysis_bands(n, lowf, step);
+
+    analysis->n = n;
+    analysis->m = m;
+    analysis->pow2 = (n & (n - 1)) == 0;
+    if (! fft_plan_init(&analysis->plan, arena, n)) return false;
+    planner_tune(&analysis->plan); // Fastest kernel for n on this machine, measured once and kept in the wisdom file
+    analysis->lowf = lowf;
+    analysis->step = step;
+
+    analysis->in = (float *) arena_alloc(arena, n * sizeof(float));
+    analysis->out = (float complex *) arena_alloc(arena, n * sizeof(float complex));
+    analysis->power = (float *) arena_alloc(arena, n / 2 * sizeof(float));
+    analysis->tw = (float complex *) arena_alloc(arena, n / 2 * sizeof(float complex));
+    analysis->window = (float *) arena_alloc(arena, n * sizeof(float));
+    analysis->bands = (float *) arena_alloc(arena, m * sizeof(float));
+    if (analysis->in == NULL || analysis->out == NULL || analysis->power == NULL || analysis->tw == NULL ||
+        analysis->window == NULL || analysis->bands == NULL) {
+        return false;
+    }
+
+    fast_twiddles(analysis->tw, n);
+    fast_hann(analysis->window, n);
+
+    // Power of a full scale sine through the Hann window (|X| = N/4), the 0 dBFS reference
+    analysis->full_scale_db = 10.0f * log10f((float) n * n / 16.0f);
+    analysis->gate_energy = n * pow(10.0, ANALYSIS_GATE_DB / 10.0); // Mean square at the gate times N
+    analysis->frames = 0;
+    analysis->gated = 0;
+    analysis_reset(analysis);
+    return true;
+}
+
+float analysis_db(float power)
+{
+    return fast_math_enabled(FAST_LOG) ? fast_power_db(power) : 10.0f * log10f(power);
+}
+
+void analysis_frame(Analysis * analysis, const float * samples)
+{
+    const size_t N = analysis->n;
+
+    // Windowing function (remove phantom frequencies)
+    if (fast_math_enabled(FAST_TRIG)) {
+        for (size_t i = 0; i < N; i++) analysis->in[i] = samples[i] * analysis->window[i];
+    } else {
+        for (size_t i = 0; i < N; i++) {
+            float t = (float) i / (N - 1);
+            float hann = 0.5 - 0.5 * cosf(2 * FFT_PI * t);
+            analysis->in[i] = samples[i] * hann;
+        }
+    }
+
+    if (fast_math_enabled(FAST_TRIG) || ! analysis->pow2) {
+        fft_plan_real(&analysis->plan, analysis->in, analysis->out);
+    } else {
+        fft(analysis->in, 1, analysis->out, N, analysis->tw); // cexpf() per butterfly
+    }
+    analysis->frames++;
+    analysis->floor_out = false;
+
+    // Single pass over the spectrum: reduce each log spaced band to its level in dBFS
+    float frame_peak = -INFINITY;
+    size_t i = 0;
+    for (float f = analysis->lowf; (size_t) f < N/2; f = ceilf(f * analysis->step)) {
+        float next_f = ceilf(f * analysis->step);
+        float max_power = 0;
+        for (size_t q = (size_t) f; q < N/2 && q < (size_t) next_f; q++) {
+            float power = cmag2f(analysis->out[q]);
+            analysis->power[q] = power;
+            if (power > max_power) max_power = power;
+        }
+        float db = analysis_db(max_power) - analysis->full_scale_db; // dBFS
+        if (db > frame_peak) frame_peak = db;
+        analysis->bands[i] = db;
+        i++;
+    }
+    analysis->frame_peak = frame_peak;
+}
+
+bool analysis_frame_gated(Analysis * analysis, const float * samples, double energy)
+{
+    if (energy >= analysis->gate_energy) {
+        analysis_frame(analysis, samples);
+        return false;
+    }
+
+    analysis->frames++;
+    analysis->gated++;
+    analysis->frame_peak = ANALYSIS_FLOOR_DB; // Smoothing (AGC, bars) decays toward it as after a real frame
+    if (analysis->floor_out) return true;     // Still there from the previous gated frame
+
+    for (size_t i = 0; i < analysis->m; i++) analysis->bands[i] = ANALYSIS_FLOOR_DB;
+    for (size_t q = 0; q < analysis->n / 2; q++) analysis->power[q] = 0.0f;
+    analysis->floor_out = true;
+    return true;
+}
+
+void analysis_reset(Analysis * analysis)
+{
+    for (size_t i = 0; i < analysis->m; i++) analysis->bands[i] = -INFINITY; // Silence until the first frame
+    for (size_t q = 0; q < analysis->n / 2; q++) analysis->power[q] = 0.0f;
+    analysis->frame_peak = -INFINITY;
+    analysis->floor_out = false;
+}
@@ -0,0 +1,66 @@
+#ifndef ANALYSIS_H_
+#define ANALYSIS_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "fft.h"
+
+#define ANALYSIS_LOWF 1.0f    // Default first band (bins)
+#define ANALYSIS_STEP 1.06f   // Default band growth, from the Frequency Table Formula
+#define ANALYSIS_GATE_DB -80.0f   // Frames with a lower RMS (dBFS) skip the FFT, 20 dB under the bars floor
+#define ANALYSIS_FLOOR_DB -120.0f // Band level of a gated frame
+
+// One analysis pipeline: Hann window -> FFT -> log spaced bands in dBFS. Any N works (e.g. N = 4800 for 100 ms
+// windows at 48 kHz), the FFT is a Stockham plan. The radix-2 fft() only remains as the libm reference (FAST_TRIG
+// off). Everything it touches lives in the struct and in the arena it was carved from, so any number of them can run
+// at the same time on different threads
+typedef struct {
+    size_t n;                 // FFT size
+    size_t m;                 // Number of bands
+    float lowf;               // The low frequency that is the base for calculations
+    float step;               // Constant from Frequency Table Formula
+
+    float * in;               // Windowed copy of the input samples (N)
+    float complex * out;      // Spectrum (N)
+    float * power;            // Squared magnitude of each bin of the last frame, reused by onset detection (N/2)
+    float complex * tw;       // FFT twiddle table (N/2)
+    bool pow2;                // N is a power of 2 (the radix-2 reference can run)
+    FftPlan plan;             // Mixed radix / Bluestein plan, kernel picked by the planner
+    float * window;           // Hann window table (N)
+    float * bands;            // Band levels of the last frame in dBFS (M)
+
+    float full_scale_db;      // Band level of a full scale sine for this N (0 dBFS)
+    float frame_peak;         // Loudest band of the last frame (dBFS)
+
+    double gate_energy;       // Frame energy (sum of x^2) under which the frame is gated
+    bool floor_out;           // bands and power already hold the floor spectrum
+    size_t frames;            // Frames analyzed (gated included)
+    size_t gated;             // Frames that skipped the FFT
+} Analysis;
+
+// Number of bands for this N
+size_t analysis_bands(size_t n, float lowf, float step);
+
+// Arena bytes analysis_init() needs (add it to the capacity of a shared arena)
+size_t analysis_arena_size(size_t n, float lowf, float step);
+
+// Carve the buffers out of arena and fill the tables. Returns false if the arena is too small
+bool analysis_init(Analysis * analysis, Arena * arena, size_t n, float lowf, float step);
+
+// Analyze the N samples starting at samples: window, FFT and reduce to bands
+void analysis_frame(Analysis * analysis, const float * samples);
+
+// Same as analysis_frame, unless energy (sum of the squares of the N samples, kept by the caller as samples come and
+// go) is under the gate: then the floor spectrum is emitted without windowing or transforming. Returns true if gated
+bool analysis_frame_gated(Analysis * analysis, const float * samples, double energy);
+
+// Forget the last frame (bands back to silence)
+void analysis_reset(Analysis * analysis);
+
+// Level in dB from a squared magnitude (fast or libm log depending on FAST_LOG)
+float analysis_db(float power);
+
+#endif // ANALYSIS_H_
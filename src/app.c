@@ -1,3 +1,5 @@
+#define _DEFAULT_SOURCE // posix_memalign
+
 #include <stdlib.h>
 #include <math.h>
 #include <complex.h>
@@ -5,9 +7,16 @@
 #include <stdio.h>
 #include <raylib.h>
 #include <assert.h>
+#include <stdint.h>
+#include <time.h>
 
+#include "analysis.h"
 #include "app.h"
+#include "clock.h"
+#include "fastmath.h"
+#include "font.h"
 #include "logger.h"
+#include "normalize.h"
 
 #define C_DARK_GRAY     CLITERAL(Color){ 0x23, 0x23, 0x23, 0xFF } // Dark  Gray
 #define C_LIGHT_GRAY    CLITERAL(Color){ 0xCC, 0xCC, 0xCC, 0xFF } // Light Gray
@@ -21,13 +30,69 @@ const Color TEXT_COLOR       = C_LIGHT_GRAY;
 
 const float TEXT_SPACING = 2.0f;
 
+const float METER_WIDTH = 60.0f;     // Level meters strip at the right of the bars
+const float METER_RANGE_DB = 60.0f;  // Meters show [-60, 0] dBFS / LUFS
+
+const unsigned int ANALYSIS_HZ = 15; // Analysis frames per second of music (the old 1 in 4 frames at 60 FPS)
+const float DEFAULT_LATENCY = 0.03f; // Output latency guess (s): miniaudio's default periods, $MUSIALIZER_AV_LATENCY_MS
+const float LATENCY_STEP = 0.005f;   // [ and ] in dev builds, to line the bars up with what is heard
+const double MAX_EXTRAPOLATION = 0.05; // Longest the music clock is run on without a mixer read (s)
+const float SEEK_STEP = 5.0f;        // Seconds jumped by the arrow keys
+const long MIN_FFT_N = 64;           // $MUSIALIZER_FFT_N bounds
+const long MAX_FFT_N = 65536;
+
+const int ACTIVE_FPS = 60;           // FPS set to 60 to stop flikering the sound, 30 for testing
+const int UNFOCUSED_FPS = 30;
+const double IDLE_TICK = 0.1;        // Seconds between polls while a background job runs and nothing plays
+const unsigned int PULSE_STEPS = 8;  // Beat dot fade levels that count as a visible change
+static const char * POWER_NAMES[POWER_COUNT] = { "active", "unfocused", "background", "idle", "sleep" };
+
 static AppState * global_state;
 
-size_t calculate_m(const size_t n, const float step, const float low_freq)
+// Keys check_key_pressed reacts to. Polled with IsKeyPressed for the redraw decision, which leaves raylib's key
+// queue alone (GetKeyPressed would pop a key from it every frame)
+static const int APP_KEYS[] = {
+    KEY_ENTER, KEY_LEFT, KEY_RIGHT, KEY_SPACE, KEY_MINUS, KEY_EQUAL, KEY_S, KEY_G,
+#ifdef DEV_ENV
+    KEY_L, KEY_T, KEY_P, KEY_LEFT_BRACKET, KEY_RIGHT_BRACKET, KEY_U,
+#endif
+};
+
+#ifdef DEV_ENV // UI frame time numbers: U switches between the retained text and laying out glyphs every frame
+static bool ui_retained = true;
+static double ui_seconds = 0.0;      // Time spent in draw_ui since the last report
+static unsigned int ui_frames = 0;
+static double ui_last_ms = 0.0;      // Last reported average, for the profiler overlay
+const unsigned int UI_REPORT_FRAMES = 600;
+#endif
+
+// Carve every analysis buffer for N out of the arena in one go (zeroed and cache line aligned)
+void alloc_analysis_buffers(AppState * state, size_t n)
 {
-    size_t m = 0; // M frequencies
-    for (float f = low_freq; (size_t) f < n/2; f = ceilf(f * step)) m++;
-    return m;
+    const size_t capacity = capture_arena_size(n)                                 // capture ring
+                          + ARENA_ALIGN(n * sizeof(float))                        // frame
+                          + analysis_arena_size(n, ANALYSIS_LOWF, ANALYSIS_STEP)  // in2, out, tables and bands
+                          + onset_arena_size(n / 2);                              // previous magnitudes
+
+    if (! arena_reserve(&state->arena, capacity)) {
+        fprintf(stderr, "Could not allocate the analysis buffers");
+        exit(1);
+    }
+
+    state->n = n;
+    state->render.analyzed = SIZE_MAX;
+    state->render.played = 0.0f;
+    state->render.played_wall = 0.0;
+    state->render.loops = 0;
+    // The capacity above covers all of them, a failure here means the sizes and the inits disagree
+    if (! capture_init(&state->capture, &state->arena, n) ||
+        (state->render.frame = (float *) arena_alloc(&state->arena, n * sizeof(float))) == NULL ||
+        ! analysis_init(&state->render.analysis, &state->arena, n, ANALYSIS_LOWF, ANALYSIS_STEP) ||
+        ! onset_init(&state->render.onset, &state->arena, n / 2)) {
+        fprintf(stderr, "Could not carve the analysis buffers for N = %zu", n);
+        exit(1);
+    }
+    norm_reset(&state->render.norm);
 }
 
 void load_music(AppState * state, const char * file_path)
@@ -48,8 +113,11 @@ void load_music(AppState * state, const char * file_path)
 
     // Setup
     state->music_len = GetMusicTimeLength(state->music);
-    state->curr_time = GetMusicTimePlayed(state->music);
+    state->render.curr_time = GetMusicTimePlayed(state->music);
     SetMusicVolume(state->music, state->curr_volume);
+    meter_init(&state->meter, state->music.stream.sampleRate);
+    state->render.hop = state->music.stream.sampleRate / ANALYSIS_HZ;
+    overview_start(&state->overview, file_path);
 }
 
 // Must use global_state because you cannot pass the state and keep a valid callback signature
@@ -60,76 +128,92 @@ void audio_callback(void * data, unsigned int framesc)
         return;
     }
 
-    const size_t N = global_state->n;
-    size_t size = global_state->in_size;
-    float * in = global_state->in1;
+    // Levels see every sample of both channels
+    meter_process(&global_state->meter, (const float *) data, framesc);
 
-    if (N < framesc) {
-        for (size_t i = 0; i < N; i++) {
-            float left = ((float *) data)[i * 2];
-            in[i] = left;
-        }
-        return;
-    }
+    // Tagged with their stream position, the render thread picks the window that is being heard
+    capture_push(&global_state->capture, (const float *) data, framesc, 2);
+}
 
-    if (framesc > N - size) {
-        size = N - framesc;
-        for (size_t i = 0; i < size; i++) in[i] = in[i + framesc];
-    }
+// A track or a raw PCM stream feeds the capture ring
+bool source_ready(AppState * state)
+{
+    return state->pcm != NULL || IsMusicReady(state->music);
+}
 
-    for (size_t i = 0; i < framesc; i++) {
-        float left = ((float *) data)[i * 2];
-        in[size + i] = left;
-    }
-    size += framesc;
+unsigned int source_rate(AppState * state)
+{
+    return state->pcm != NULL ? state->pcm->config.sample_rate : state->music.stream.sampleRate;
+}
+
+// A raw stream plays until it is paused or its last captured frame was reached after the input ended
+bool source_playing(AppState * state)
+{
+    if (state->pcm == NULL) return IsMusicStreamPlaying(state->music);
+    if (state->pcm_paused) return false;
+    return ! pcm_eof(state->pcm) || state->render.stream_pos < (double) capture_end(&state->capture);
+}
+
+// Set a retained UI string in the app font (no work when the content did not change)
+void set_text(AppState * state, CachedText * text, const char * content, Color color)
+{
+    text_cache_set(text, state->font, TEXT_SPACING, content, color);
 }
 
 // Set UI string based on playing state
 void set_playing(AppState * state, bool is_playing)
 {
-    if (is_playing) {
-        strncpy(state->str.play_state, "Playing...", sizeof(state->str.play_state));
-    } else {
-        strncpy(state->str.play_state, "Not Playing", sizeof(state->str.play_state));
-    }
+    set_text(state, &state->str.play_state, is_playing ? "Playing..." : "Not Playing", DARKGRAY);
+}
+
+// CPU time of every thread of the process (render, audio and background jobs)
+static double cpu_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 AppState * app_init(const char * file_path)
 {
-    AppState * state = malloc(sizeof(AppState));
+    // Cache line aligned so the capture and render regions never share a line
+    AppState * state = NULL;
+    if (posix_memalign((void **) &state, CACHE_LINE, sizeof(AppState)) != 0) {
+        fprintf(stderr, "Could not allocate the app state");
+        exit(1);
+    }
+    memset(state, 0, sizeof(AppState));
+    state->publisher.fd = -1;
+    global_state = state; // Before any audio callback can be attached
 
     // Window
     state->width = 800;
     state->height = 600;
 
-    // Input/Output buffers
-    state->n = (size_t) 2 << 9; // 2 << 13 == 16,384 (13 is default, min is 9)
-    state->in1 = (float *) calloc(state->n, sizeof(float));
-    state->in2 = (float *) calloc(state->n, sizeof(float));
-    state->out = (float complex *) calloc(state->n, sizeof(float complex));
-    state->in_size = 0;
-
-    // Calculate frequencies
-    state->lowf = 1.0f;
-    state->step = 1.06f;
-    state->m = calculate_m(state->n, state->step, state->lowf);
+    // Input/Output buffers: any N, $MUSIALIZER_FFT_N=4800 gives 100 ms windows at 48 kHz
+    const char * fft_n = getenv("MUSIALIZER_FFT_N");
+    const long n = fft_n != NULL ? atol(fft_n) : 0;
+    alloc_analysis_buffers(state, n >= MIN_FFT_N && n <= MAX_FFT_N ? (size_t) n : (size_t) 2 << 9); // 2 << 13 == 16,384
 
-    // Skip frames
-    state->skip_c = 0;
+    // A/V: mixer to speakers latency, the analysis looks this far back from the newest captured sample
+    const char * latency_ms = getenv("MUSIALIZER_AV_LATENCY_MS");
+    state->latency = latency_ms != NULL ? (float) atof(latency_ms) / 1000.0f : DEFAULT_LATENCY;
 
-    // UI strings
-    strncpy(state->str.title, "Musializer", sizeof(state->str.title));
-    strncpy(state->str.drag_txt, "Drag & Drop Music Files Here", sizeof(state->str.drag_txt));
-#ifdef DEV_ENV // String to print N on dev mode
-    snprintf(state->str.n_str, sizeof(state->str.n_str), "%zu", state->n);
-#endif
+    // Bars span a fixed dB window, G toggles the automatic gain
+    norm_init(&state->render.norm, -60.0f, 0.0f);
 
     // Error
     strncpy(state->error.message, "", sizeof(state->error.message));
     state->error.has_error = false;
 
+    // Always run: raylib stops the loop while minimized, which would also stop feeding the music stream. The
+    // background power state keeps that loop cheap instead
+    SetConfigFlags(FLAG_WINDOW_ALWAYS_RUN);
     InitWindow(state->width, state->height, "Musializer");
-    SetTargetFPS(60); // FPS set to 60 to stop flikering the sound, 30 for testing
+    SetTargetFPS(ACTIVE_FPS);
+    state->power.state = POWER_ACTIVE;
+    state->power.since = clock_seconds();
+    state->power.cpu_since = cpu_seconds();
     InitAudioDevice();
 
     if (file_path != NULL) {
@@ -140,10 +224,10 @@ AppState * app_init(const char * file_path)
         PlayMusicStream(state->music); // For testing can remove later
     }
 
-    // Load font
-    const int font_size = 30;
-    const int glyph_count = 250;
-    state->font = LoadFontEx("resources/fonts/NotoSans-Regular.ttf", font_size, 0, glyph_count);
+    // Load font (embedded atlas, $MUSIALIZER_FONT overrides it with a TTF)
+    const double font_start = GetTime();
+    state->font = font_load();
+    log_info("font loaded in %.2f ms", (GetTime() - font_start) * 1000.0);
 
     // Check font
     if (! IsFontReady(state->font)) {
@@ -151,23 +235,77 @@ AppState * app_init(const char * file_path)
         exit(1);
     }
 
+    // UI strings (rasterized here, they need the window and the font)
+    set_text(state, &state->str.title, "Musializer", DARKGRAY);
+    set_text(state, &state->str.drag_txt, "Drag & Drop Music Files Here", DARKGRAY);
+    state->str.vol_shown = -1;
+    state->str.time_shown = -1;
+#ifdef DEV_ENV // String to print N on dev mode
+    char n_str[32];
+    snprintf(n_str, sizeof(n_str), "%zu", state->n);
+    set_text(state, &state->str.n_str, n_str, DARKGRAY);
+#endif
+
+    // Spectrogram history one texture column per pixel of the bars area
+    state->view = VIEW_BARS;
+    spectrogram_init(&state->spectrogram, (int) (state->width - METER_WIDTH));
+
     log_info("main app initialized");
-    global_state = state;
     return state;
 }
 
+void app_publish(AppState * state, const char * name)
+{
+    publish_open(&state->publisher, name, (uint32_t) state->render.analysis.m);
+}
+
+void app_stream(AppState * state, PcmInput * pcm)
+{
+    state->pcm = pcm;
+    state->pcm_paused = false;
+    meter_init(&state->meter, pcm->config.sample_rate);
+    state->render.hop = pcm->config.sample_rate / ANALYSIS_HZ;
+    state->render.stream_pos = 0.0;
+    state->render.played_wall = GetTime();
+
+    if (! pcm_start(pcm, &state->capture, &state->meter)) {
+        state->error.has_error = true;
+        strncpy(state->error.message, "Could not read the raw PCM input", sizeof(state->error.message));
+        set_text(state, &state->str.error, state->error.message, RED);
+    }
+}
+
+// How much of the track the silence gate saved
+void log_gate_stats(AppState * state)
+{
+    const Analysis * analysis = &state->render.analysis;
+    if (analysis->frames == 0) return;
+    log_info("analysis: %zu of %zu frames gated as silence (%.1f%%, no FFT)", analysis->gated, analysis->frames,
+             100.0 * analysis->gated / analysis->frames);
+}
+
 void app_unload_and_close(AppState * state)
 {
-    free(state->in1);
-    free(state->in2);
-    free(state->out);
+    log_gate_stats(state);
 
     // Raylib
     if (IsMusicReady(state->music)) {
         DetachAudioStreamProcessor(state->music.stream, audio_callback);
         UnloadMusicStream(state->music);
     }
+    if (state->pcm != NULL) pcm_close(state->pcm); // Joins the reader, it writes into the capture ring too
+    publish_close(&state->publisher);
+    arena_free(&state->arena); // After the callback is detached, it writes into the capture ring
     UnloadFont(state->font);
+    text_cache_unload(&state->str.title);
+    text_cache_unload(&state->str.vol_time);
+    text_cache_unload(&state->str.play_state);
+    text_cache_unload(&state->str.n_str);
+    text_cache_unload(&state->str.bpm);
+    text_cache_unload(&state->str.drag_txt);
+    text_cache_unload(&state->str.error);
+    spectrogram_unload(&state->spectrogram);
+    overview_free(&state->overview);
 
     free(state);
 
@@ -177,13 +315,71 @@ void app_unload_and_close(AppState * state)
     log_info("main app unload and closed");
 }
 
-void check_key_pressed(AppState * state)
+// Throw away everything computed from the old position. The analysis window is refilled straight from the decoded
+// track (when the overview has it) so the very next FFT already shows the new position
+void flush_analysis(AppState * state, float time)
+{
+    size_t frames = 0;
+    unsigned int sample_rate = 0;
+    const float * pcm = overview_pcm(&state->overview, &frames, &sample_rate);
+    const size_t pos = (size_t) (time * state->music.stream.sampleRate);
+    if (pcm == NULL) overview_want_pcm(&state->overview); // After a cache hit: decode now, for the next seeks
+
+    // Ring restarts at the new position, with the decoded audio before it (enough for the window and the latency)
+    if (pcm != NULL && pos <= frames) {
+        capture_reset(&state->capture, pos, pcm, pos);
+    } else {
+        capture_reset(&state->capture, pos, NULL, 0);
+    }
+
+    // Smoothing state
+    analysis_reset(&state->render.analysis);
+    onset_reset(&state->render.onset);
+    norm_reset(&state->render.norm);
+    meter_init(&state->meter, state->music.stream.sampleRate);
+
+    state->render.analyzed = SIZE_MAX; // FFT of the refilled window on the next frame, even while paused
+    state->render.played = time;
+    state->render.played_wall = GetTime();
+    state->render.loops = 0;
+    state->render.curr_time = time;
+}
+
+void seek_music(AppState * state, float time)
+{
+    if (time < 0.0f) time = 0.0f;
+    if (time > state->music_len) time = state->music_len;
+
+    // Detached the callback cannot run, so the capture buffer can be refilled safely
+    DetachAudioStreamProcessor(state->music.stream, audio_callback);
+    SeekMusicStream(state->music, time);
+    flush_analysis(state, time);
+    AttachAudioStreamProcessor(state->music.stream, audio_callback);
+}
+
+Rectangle seek_bar_rect(AppState * state)
+{
+    return (Rectangle) { 15, 10, state->width - 30, 40 };
+}
+
+// Playback of a music file: restart, seek, pause and volume
+void check_transport_keys(AppState * state)
 {
     if (IsKeyPressed(KEY_ENTER)) { // Start / Restart
         StopMusicStream(state->music);
+        seek_music(state, 0.0f);
         PlayMusicStream(state->music);
     }
 
+    if (IsKeyPressed(KEY_LEFT)) seek_music(state, GetMusicTimePlayed(state->music) - SEEK_STEP); // Seek back
+    if (IsKeyPressed(KEY_RIGHT)) seek_music(state, GetMusicTimePlayed(state->music) + SEEK_STEP); // Seek forward
+
+    // Click on the seek bar
+    const Rectangle bar = seek_bar_rect(state);
+    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(GetMousePosition(), bar)) {
+        seek_music(state, (GetMousePosition().x - bar.x) / bar.width * state->music_len);
+    }
+
     if (IsKeyPressed(KEY_SPACE)) { // Pause / Resume
         if (IsMusicStreamPlaying(state->music)) {
             PauseMusicStream(state->music);
@@ -203,23 +399,85 @@ void check_key_pressed(AppState * state)
     }
 }
 
+void check_key_pressed(AppState * state)
+{
+    if (state->pcm != NULL) {
+        if (IsKeyPressed(KEY_SPACE)) state->pcm_paused = ! state->pcm_paused; // Pause / Resume the stream clock
+    } else {
+        check_transport_keys(state);
+    }
+
+    if (IsKeyPressed(KEY_S)) { // Bars / Spectrogram
+        state->view = state->view == VIEW_BARS ? VIEW_SPECTROGRAM : VIEW_BARS;
+    }
+
+    if (IsKeyPressed(KEY_G)) { // Automatic gain on / off
+        state->render.norm.agc = ! state->render.norm.agc;
+        norm_reset(&state->render.norm);
+    }
+
+#ifdef DEV_ENV // A/B the fast math paths against libm
+    if (IsKeyPressed(KEY_L)) {
+        fast_math_toggle(FAST_LOG);
+        log_info("fast log: %s", fast_math_enabled(FAST_LOG) ? "on" : "off (libm)");
+    }
+
+    if (IsKeyPressed(KEY_T)) {
+        fast_math_toggle(FAST_TRIG);
+        log_info("fast trig: %s", fast_math_enabled(FAST_TRIG) ? "on" : "off (libm)");
+    }
+
+    if (IsKeyPressed(KEY_P)) state->profiler = ! state->profiler;
+
+    if (IsKeyPressed(KEY_LEFT_BRACKET) && state->latency >= LATENCY_STEP) state->latency -= LATENCY_STEP;
+    if (IsKeyPressed(KEY_RIGHT_BRACKET)) state->latency += LATENCY_STEP;
+
+    if (IsKeyPressed(KEY_U)) {
+        ui_retained = ! ui_retained;
+        ui_seconds = 0.0;
+        ui_frames = 0;
+        log_info("ui text: %s, retained vs immediate max pixel error %d", ui_retained ? "retained" : "immediate",
+                 text_cache_max_error(&state->str.vol_time, state->font, TEXT_SPACING, BACKGROUND_COLOR));
+    }
+#endif
+}
+
 void update_ui(AppState * state)
 {
-    if (! IsMusicStreamPlaying(state->music)) {
+    if (! source_playing(state)) {
         set_playing(state, false);
         return;
     }
 
-    float updated_music_time = GetMusicTimePlayed(state->music);
+    float updated_music_time = state->pcm != NULL ? state->render.stream_pos / state->pcm->config.sample_rate
+                                                  : GetMusicTimePlayed(state->music);
+    state->render.curr_time = updated_music_time;
+
+    // Makes the text for: (<volume>) <current_time> / <total_time>, only when a shown number changes
+    const int vol = (int) roundf(state->curr_volume * 100);
+    const int time = (int) roundf(updated_music_time);
+    if (vol != state->str.vol_shown || time != state->str.time_shown) {
+        char vol_time[64];
+        if (state->pcm != NULL) {
+            snprintf(vol_time, sizeof(vol_time), "(pcm) %3d s", time); // Not played, no volume or length
+        } else {
+            snprintf(vol_time, sizeof(vol_time), "(%2d) %3d / %3.0f", vol, time, state->music_len);
+        }
+        set_text(state, &state->str.vol_time, vol_time, DARKGRAY);
+        state->str.vol_shown = vol;
+        state->str.time_shown = time;
+    }
 
-    // update gap 200ms (5x sec)
-    if (updated_music_time - state->curr_time > 0.2) {
-        state->curr_time = updated_music_time;
-        // Makes the text for: (<volume>) <current_time> / <total_time>
-        snprintf(state->str.vol_time, sizeof(state->str.vol_time), "(%2.0f) %3.0f / %3.0f",
-                 state->curr_volume * 100, updated_music_time, state->music_len);
-        set_playing(state, true);
+    // Tempo, once the tracker has an estimate
+    const int bpm = (int) roundf(state->render.onset.bpm);
+    if (bpm != state->str.bpm_shown) {
+        char bpm_str[32] = "";
+        if (bpm > 0) snprintf(bpm_str, sizeof(bpm_str), "%3d BPM", bpm);
+        set_text(state, &state->str.bpm, bpm_str, DARKGRAY);
+        state->str.bpm_shown = bpm;
     }
+
+    set_playing(state, true);
 }
 
 void check_file_dropped(AppState * state)
@@ -227,12 +485,23 @@ void check_file_dropped(AppState * state)
     if (IsFileDropped()) {
         FilePathList droppedFiles = LoadDroppedFiles();
         if (droppedFiles.count > 0) {
+            if (state->pcm != NULL) { // A dropped file replaces the raw stream
+                pcm_close(state->pcm);
+                state->pcm = NULL;
+            }
             if (IsMusicReady(state->music)) {
                 StopMusicStream(state->music);
                 DetachAudioStreamProcessor(state->music.stream, audio_callback);
                 UnloadMusicStream(state->music);
             }
 
+            overview_free(&state->overview);
+            log_gate_stats(state);
+
+            // New track starts from clean buffers (callback is detached so nothing writes to them now)
+            alloc_analysis_buffers(state, state->n);
+            spectrogram_clear(&state->spectrogram);
+
             const char * file_path = droppedFiles.paths[0];
             load_music(state, file_path);
 
@@ -241,6 +510,7 @@ void check_file_dropped(AppState * state)
                 state->error.has_error = true;
                 strncpy(state->error.message, "Dropped file is not valid",
                         sizeof(state->error.message));
+                set_text(state, &state->str.error, state->error.message, RED);
             } else {
                 state->error.has_error = false;
                 AttachAudioStreamProcessor(state->music.stream, audio_callback);
@@ -251,148 +521,416 @@ void check_file_dropped(AppState * state)
     }
 }
 
-void app_update(AppState * state)
+// Draw a retained UI string with its top left corner at pos
+void draw_text(AppState * state, const CachedText * text, Vector2 pos)
 {
-    if (IsMusicReady(state->music)) {
-        UpdateMusicStream(state->music);
-        check_key_pressed(state);
-        update_ui(state);
+#ifdef DEV_ENV
+    if (! ui_retained) {
+        DrawTextEx(state->font, text->text, pos, (float) state->font.baseSize, TEXT_SPACING, text->color);
+        return;
     }
-    check_file_dropped(state);
-}
-
-// Call DrawTextEx with some values already set to simplify the call (default color)
-void draw_text(const Font font, const char * text, const Vector2 pos)
-{
-    DrawTextEx(font, text, pos, (float) font.baseSize, TEXT_SPACING, DARKGRAY);
+#else
+    (void) state;
+#endif
+    text_cache_draw(text, pos);
 }
 
-// Call DrawTextEx with some values already set to simplify the call
-void draw_text_color(const Font font, const char * text, const Vector2 pos, Color color)
+// Draw a retained UI string centered in the window
+void draw_text_centered(AppState * state, const CachedText * text)
 {
-    DrawTextEx(font, text, pos, (float) font.baseSize, TEXT_SPACING, color);
+    const Vector2 center = { state->width / 2, state->height / 2 };
+#ifdef DEV_ENV
+    if (! ui_retained) {
+        const Vector2 dimensions = MeasureTextEx(state->font, text->text, (float) state->font.baseSize, TEXT_SPACING);
+        draw_text(state, text, (Vector2) { center.x - (dimensions.x / 2), center.y - (dimensions.y / 2) });
+        return;
+    }
+#endif
+    text_cache_draw_centered(text, center);
 }
 
 void draw_ui(AppState * state)
 {
-    // TODO: come up with some king of strut to be used here and that can be store
-    // not just with the text be with the Vector2 too
     if (IsMusicReady(state->music)) {
         // App title
-        draw_text(state->font, state->str.title, (Vector2) { 15, state->height - 40 });
+        draw_text(state, &state->str.title, (Vector2) { 15, state->height - 40 });
         // Is it playing or not feedback
-        draw_text(state->font, state->str.play_state, (Vector2) {
-                state->width - 320, state->height - 40 });
+        draw_text(state, &state->str.play_state, (Vector2) { state->width - 320, state->height - 40 });
         // Temp and Volume to the corner
-        const float extra_padding = state->curr_time >= 100 ? 5 : 0;
-        draw_text(state->font, state->str.vol_time, (Vector2) {
-                state->width - 168 - extra_padding, state->height - 40 });
+        const float extra_padding = state->render.curr_time >= 100 ? 5 : 0;
+        draw_text(state, &state->str.vol_time, (Vector2) { state->width - 168 - extra_padding, state->height - 40 });
+        // Tempo with a dot that flashes on the beat
+        if (state->str.bpm_shown > 0) {
+            const float pulse = 1.0f - state->render.onset.beat_phase;
+            DrawCircle(state->width - 470, state->height - 30, 6 + 4 * pulse, Fade(RECT_COLOR, pulse));
+            draw_text(state, &state->str.bpm, (Vector2) { state->width - 455, state->height - 40 });
+        }
 #ifdef DEV_ENV // String to print N on dev mode
-        draw_text(state->font, state->str.n_str, (Vector2) { 165, state->height - 40 });
+        draw_text(state, &state->str.n_str, (Vector2) { 165, state->height - 40 });
 #endif
     } else if (state->error.has_error) {
-        const Vector2 dimensions = MeasureTextEx(state->font, state->error.message,
-                (float) state->font.baseSize, TEXT_SPACING);
-        draw_text_color(state->font, state->error.message, (Vector2) {
-                (state->width / 2) - (dimensions.x / 2),
-                (state->height / 2) - (dimensions.y / 2) }, RED);
+        draw_text_centered(state, &state->str.error);
     } else {
-        const Vector2 dimensions = MeasureTextEx(state->font, state->str.drag_txt,
-                (float) state->font.baseSize, TEXT_SPACING);
-        draw_text(state->font, state->str.drag_txt, (Vector2) {
-                (state->width / 2) - (dimensions.x / 2),
-                (state->height / 2) - (dimensions.y / 2) });
+        draw_text_centered(state, &state->str.drag_txt);
     }
 }
 
-void fft(float in[], size_t step, float complex out[], size_t n)
+// Raw PCM is not played: the wall clock advances the position while not paused, held back to the captured end so a
+// live producer sets the pace and a faster one is throttled by the ring. Frames before the next window are released
+size_t stream_position(AppState * state)
 {
-    assert(n > 0);
+    AppRender * render = &state->render;
+    const double now = GetTime();
+    if (! state->pcm_paused) render->stream_pos += (now - render->played_wall) * state->pcm->config.sample_rate;
+    render->played_wall = now;
+
+    const double newest = (double) capture_end(&state->capture);
+    if (render->stream_pos > newest) render->stream_pos = newest;
+
+    const size_t position = (size_t) render->stream_pos;
+    const size_t oldest = state->n + render->hop; // Windows end on the grid point at or before position
+    pcm_release(state->pcm, position > oldest ? position - oldest : 0);
+    return position;
+}
 
-    if (n == 1) {
-        out[0] = in[0];
-        return;
-    }
+// Stream position of the sample coming out of the speakers now: the mixer clock (GetMusicTimePlayed, run on between
+// mixer reads) minus the output latency, in the same numbering as the capture ring
+size_t heard_position(AppState * state)
+{
+    if (state->pcm != NULL) return stream_position(state);
 
-    fft(in,        step * 2, out,         n / 2);
-    fft(in + step, step * 2, out + n / 2, n / 2);
+    AppRender * render = &state->render;
+    const unsigned int sample_rate = state->music.stream.sampleRate;
+    const float played = GetMusicTimePlayed(state->music);
+    const double now = GetTime();
 
-    for (size_t k = 0; k < n / 2; k++) {
-        float t  = (float) k / n;
-        float complex v = cexp(-2 * I * PI * t) * out[k + n / 2];
-        float complex e = out[k];
-        out[k]         = e + v;
-        out[k + n / 2] = e - v;
+    if (played != render->played) {
+        if (played < render->played - 1.0f) render->loops++; // Looping track restarted, the ring did not
+        render->played = played;
+        render->played_wall = now;
     }
+
+    double seconds = played - state->latency;
+    if (IsMusicStreamPlaying(state->music)) {
+        const double run_on = now - render->played_wall;
+        seconds += run_on < MAX_EXTRAPOLATION ? run_on : MAX_EXTRAPOLATION;
+    }
+
+    const double position = seconds * sample_rate + (double) render->loops * state->music.frameCount;
+    return position > 0.0 ? (size_t) position : 0;
 }
 
-void fft_skip_frames(AppState * state)
+// Analyze the window ending at the heard sample, on the hop grid so frames are evenly spaced in music time no matter
+// the frame rate. True when a new spectrum was computed
+bool analyze_heard(AppState * state)
 {
-    // Make the animation slower (skiping the change of state->out)
-    const unsigned int skip_step = 3; // only fft on every (n + 1) frames
+    AppRender * render = &state->render;
+    const unsigned int sample_rate = source_rate(state);
+    if (render->hop == 0) return false;
 
-    const size_t N = state->n;
-    if (state->skip_c >= skip_step) {
-        for (size_t i = 0; i < N; i++) {
-            float t = (float) i / (N - 1);
-            // Windowing function (remove phantom frequencies)
-            float hann = 0.5 - 0.5 * cosf(2 * PI * t);
-            state->in2[i] = state->in1[i] * hann;
-        }
+    const size_t heard = heard_position(state);
+    const size_t end = heard / render->hop * render->hop;
+    if (end == render->analyzed) return false; // Same grid point (always while paused)
 
-        fft(state->in2, 1, state->out, state->n);
+    // The newest data can still be behind the clock (latency set too low, stream just started): use what is there
+    const size_t newest = capture_end(&state->capture);
+    const size_t window_end = end < newest ? end : newest;
+    double energy = 0.0;
+    if (! capture_window(&state->capture, window_end, state->n, render->frame, &energy)) return false;
 
-        state->skip_c = 0;
-    } else {
-        state->skip_c++;
-    }
+    render->av_lead_ms = ((double) newest - heard) * 1000.0 / sample_rate;
+    render->av_error_ms = ((double) window_end - end) * 1000.0 / sample_rate;
+
+    // Silent window: floor spectrum, no window/FFT/log
+    analysis_frame_gated(&render->analysis, render->frame, energy);
+
+    // Spaced by the grid, so the tempo does not depend on the frame rate
+    const float dt = render->analyzed < end ? (float) (end - render->analyzed) / sample_rate : 0.0f;
+    onset_process(&render->onset, render->analysis.power, render->analyzed == SIZE_MAX ? 0.0f : dt);
+
+    render->analyzed = end;
+    render->frames++;
+    return true;
 }
 
-float calc_amp(float complex x)
+void draw_rectangles(AppState * state)
 {
-    float a = crealf(x);
-    float b = cimagf(x);
-    return logf((a * a) + (b * b));
+    const Analysis * analysis = &state->render.analysis;
+    const float cell_width = (state->width - METER_WIDTH) / analysis->m;
+    const float half_height = state->height / 2;
+    const float bottom = state->height - 50;
+
+    for (size_t i = 0; i < analysis->m; i++) {
+        // Draw Rectangles -----------------------------------------------------------------------------
+        float norm = norm_apply(&state->render.norm, analysis->bands[i]); // Normalizer
+        DrawRectangle(i * cell_width, bottom - half_height*norm, cell_width, half_height*norm, GREEN);
+    }
 }
 
-void draw_rectangles(AppState * state)
+void draw_spectrogram(AppState * state)
 {
-    const size_t N = state->n;
-    const float STEP = state->step;
-    const float LOWF = 1.0f;
+    const float half_height = state->height / 2;
+    const float bottom = state->height - 50;
+    spectrogram_draw(&state->spectrogram, (Rectangle) {
+            0, bottom - half_height, state->width - METER_WIDTH, half_height });
+}
 
-    fft_skip_frames(state);
+// Whole track overview with the play head on top
+void draw_seek_bar(AppState * state)
+{
+    const Rectangle bar = seek_bar_rect(state);
+    DrawRectangleRec(bar, Fade(BLACK, 0.3f));
+    overview_draw(&state->overview, bar, 0.0f, 1.0f);
 
-    float max_amp = 0.0f;
-    for (size_t i = 0; i < N; i++) {
-        float amp = calc_amp(state->out[i]);
-        if (max_amp < amp) max_amp = amp;
+    if (state->music_len > 0) {
+        const float x = bar.x + bar.width * GetMusicTimePlayed(state->music) / state->music_len;
+        DrawLineV((Vector2) { x, bar.y }, (Vector2) { x, bar.y + bar.height }, TEXT_COLOR);
     }
+}
+
+// Level in dB to a [0, 1] meter height
+float meter_norm(float db)
+{
+    const float t = (db + METER_RANGE_DB) / METER_RANGE_DB;
+    if (t < 0.0f) return 0.0f;
+    if (t > 1.0f) return 1.0f;
+    return t;
+}
+
+// RMS bars with a true peak line for each channel, then the short-term loudness bar
+void draw_meters(AppState * state)
+{
+    const MeterLevels levels = meter_read(&state->meter);
 
-    const float cell_width = state->width / state->m;
     const float half_height = state->height / 2;
     const float bottom = state->height - 50;
-
-    size_t i = 0;
-    for (float f = LOWF; (size_t) f < N/2; f = ceilf(f * STEP)) {
-        float next_f = ceilf(f * STEP);
-        float max = 0;
-        for (size_t q = (size_t) f; q < N/2 && q < (size_t) next_f; q++) {
-            float amp = calc_amp(state->out[q]);
-            if (amp > max) max = amp;
-        }
-        // Draw Rectangles -----------------------------------------------------------------------------
-        float norm = max / max_amp; // Normalizer
-        DrawRectangle(i * cell_width, bottom - half_height*norm, cell_width, half_height*norm, GREEN);
-        i++;
+    const float gap = 4.0f;
+    const float bar_width = (METER_WIDTH - 4 * gap) / 3;
+    float x = state->width - METER_WIDTH + gap;
+
+    for (size_t c = 0; c < METER_CHANNELS; c++) {
+        const float rms = meter_norm(levels.rms_db[c]) * half_height;
+        const float peak = meter_norm(levels.peak_db[c]) * half_height;
+        DrawRectangle(x, bottom - rms, bar_width, rms, RECT_COLOR);
+        DrawRectangle(x, bottom - peak, bar_width, 2, levels.peak_db[c] > 0.0f ? RED : TEXT_COLOR);
+        x += bar_width + gap;
     }
+
+    const float loudness = meter_norm(levels.loudness) * half_height;
+    DrawRectangle(x, bottom - loudness, bar_width, loudness, RECT_NEG_COLOR);
+}
+#ifdef DEV_ENV
+// Frame, power, A/V and analysis numbers over the bars (P toggles)
+void draw_profiler(AppState * state)
+{
+    const AppRender * render = &state->render;
+    const Analysis * analysis = &render->analysis;
+    char lines[4][128];
+    snprintf(lines[0], sizeof(lines[0]), "fps %d | power %s | drew %u of %u loops", GetFPS(),
+             POWER_NAMES[state->power.state], state->power.drawn, state->power.loops);
+    snprintf(lines[1], sizeof(lines[1]), "a/v: capture %.1f ms ahead of the speakers, compensating %.0f ms ([ ]), "
+             "window off by %.1f ms", render->av_lead_ms, state->latency * 1000.0f, render->av_error_ms);
+    snprintf(lines[2], sizeof(lines[2]), "analysis: hop %zu, %zu frames, %zu gated as silence", render->hop,
+             analysis->frames, analysis->gated);
+    snprintf(lines[3], sizeof(lines[3]), "ui: %.4f ms/frame (%s)", ui_last_ms, ui_retained ? "retained" : "immediate");
+
+    DrawRectangle(15, 60, state->width - METER_WIDTH - 30, 76, Fade(BLACK, 0.6f));
+    for (int i = 0; i < 4; i++) DrawText(lines[i], 22, 66 + 17 * i, 10, RAYWHITE);
 }
+#endif
+
 void app_draw(AppState * state)
 {
     ClearBackground(BACKGROUND_COLOR);
 
+#ifdef DEV_ENV // CPU time of the UI path, averaged over UI_REPORT_FRAMES
+    const double ui_start = GetTime();
     draw_ui(state);
+    ui_seconds += GetTime() - ui_start;
+    if (++ui_frames == UI_REPORT_FRAMES) {
+        log_info("ui (%s): %.4f ms/frame, vol_time rendered %u times", ui_retained ? "retained" : "immediate",
+                 ui_seconds * 1000.0 / ui_frames, state->str.vol_time.renders);
+        ui_last_ms = ui_seconds * 1000.0 / ui_frames;
+        ui_seconds = 0.0;
+        ui_frames = 0;
+    }
+#else
+    draw_ui(state);
+#endif
+
+    // Analysis happens in app_update, only when new samples arrived
+    if (source_ready(state)) {
+        if (state->view == VIEW_SPECTROGRAM) {
+            draw_spectrogram(state);
+        } else {
+            draw_rectangles(state);
+        }
+        draw_meters(state);
+        if (IsMusicReady(state->music)) draw_seek_bar(state); // A raw stream has no length to seek in
+    }
+
+#ifdef DEV_ENV
+    if (state->profiler) draw_profiler(state);
+#endif
+}
 
-    // TODO: Draw -> check if can skip calculations on skip frames on
-    if (IsMusicReady(state->music)) draw_rectangles(state);
+AppPower power_state(AppState * state)
+{
+    if (! source_ready(state) || ! source_playing(state)) {
+        return overview_status(&state->overview) == OVERVIEW_RUNNING ? POWER_IDLE : POWER_SLEEP;
+    }
+    if (IsWindowMinimized() || IsWindowHidden()) return POWER_BACKGROUND;
+    if (! IsWindowFocused()) return POWER_UNFOCUSED;
+    return POWER_ACTIVE;
+}
+
+// Switch the loop pacing, logging the CPU usage of the state left behind
+void set_power(AppState * state, AppPower power)
+{
+    AppPowerState * p = &state->power;
+    if (power == p->state) return;
+
+    const double wall = clock_seconds();
+    const double cpu = cpu_seconds();
+    if (wall - p->since >= 1.0) {
+        log_info("power %s: %.1f s, %.1f%% CPU, drew %u of %u loops", POWER_NAMES[p->state], wall - p->since,
+                 100.0 * (cpu - p->cpu_since) / (wall - p->since), p->drawn, p->loops);
+    }
+
+    *p = (AppPowerState) { .state = power, .since = wall, .cpu_since = cpu, .input = true };
+
+    if (power == POWER_SLEEP) {
+        EnableEventWaiting();
+    } else {
+        DisableEventWaiting();
+    }
+    SetTargetFPS(power == POWER_UNFOCUSED ? UNFOCUSED_FPS : ACTIVE_FPS);
+}
+
+// Hand the finished frame to other local processes: the bars as drawn, with the tempo and the beat
+void publish_bars(AppState * state)
+{
+    const AppRender * render = &state->render;
+    publish_frame(&state->publisher, render->analysis.bands, render->analysis.m, &render->norm, render->analyzed,
+                  source_rate(state), &render->onset);
+}
+
+// New spectrum (when samples arrived) and the normalizer smoothing
+void update_analysis(AppState * state)
+{
+    const double now = GetTime();
+    const float dt = (float) (now - state->render.update_time);
+    state->render.update_time = now;
+
+    const Analysis * analysis = &state->render.analysis;
+    if (analyze_heard(state)) {
+        // One new column per analysis frame, only while it is on screen
+        if (state->view == VIEW_SPECTROGRAM) {
+            spectrogram_push(&state->spectrogram, analysis->bands, analysis->m, &state->render.norm);
+        }
+        if (state->publisher.header != NULL) publish_bars(state);
+    }
+    norm_update(&state->render.norm, analysis->frame_peak, dt);
+}
+
+static bool app_key_pressed(void)
+{
+    for (size_t i = 0; i < sizeof(APP_KEYS) / sizeof(APP_KEYS[0]); i++) {
+        if (IsKeyPressed(APP_KEYS[i])) return true;
+    }
+    return false;
+}
+
+void app_update(AppState * state)
+{
+    // Any input redraws (hover, keys, drops), whatever the frame signature says
+    const Vector2 mouse_delta = GetMouseDelta();
+    state->power.input = app_key_pressed() || mouse_delta.x != 0 || mouse_delta.y != 0 ||
+                         IsMouseButtonPressed(MOUSE_BUTTON_LEFT) || IsFileDropped() || IsWindowResized();
+
+    if (IsMusicReady(state->music)) UpdateMusicStream(state->music);
+    if (source_ready(state)) {
+        check_key_pressed(state);
+        update_ui(state);
+    }
+    check_file_dropped(state);
+
+    set_power(state, power_state(state));
+    // Minimized only skips the analysis when nobody outside reads it
+    const bool analyze = state->power.state != POWER_BACKGROUND || state->publisher.header != NULL;
+    if (source_ready(state) && analyze) {
+        update_analysis(state);
+    } else if (state->pcm != NULL) {
+        stream_position(state); // Minimized: no FFT, but the clock and the reader keep going
+    }
+}
+
+// Hash of the numbers that decide what a frame shows, in pixels or steps: equal keys draw the same picture
+static unsigned int frame_hash(unsigned int hash, int value)
+{
+    return (hash ^ (unsigned int) value) * 16777619u; // FNV-1a step
+}
+
+unsigned int frame_key(AppState * state)
+{
+    unsigned int key = 2166136261u;
+    key = frame_hash(key, state->power.state);
+    key = frame_hash(key, source_ready(state));
+    key = frame_hash(key, state->error.has_error);
+    key = frame_hash(key, state->view);
+    key = frame_hash(key, overview_status(&state->overview));
+    if (state->profiler) key = frame_hash(key, (int) (state->render.av_lead_ms * 10) ^ GetFPS());
+    key = frame_hash(key, state->str.play_state.renders + state->str.vol_time.renders + state->str.bpm.renders +
+                          state->str.error.renders);
+    if (! source_ready(state)) return key;
+
+    key = frame_hash(key, state->render.frames);
+    if (state->render.norm.agc) key = frame_hash(key, (int) (state->render.norm.peak_db * 10)); // Gain moves bars
+
+    const Rectangle bar = seek_bar_rect(state);
+    if (state->music_len > 0) {
+        key = frame_hash(key, (int) (bar.width * GetMusicTimePlayed(state->music) / state->music_len));
+    }
+    if (state->str.bpm_shown > 0) key = frame_hash(key, (int) ((1.0f - state->render.onset.beat_phase) * PULSE_STEPS));
+
+    const MeterLevels levels = meter_read(&state->meter);
+    const float half_height = state->height / 2;
+    for (size_t c = 0; c < METER_CHANNELS; c++) {
+        key = frame_hash(key, (int) (meter_norm(levels.rms_db[c]) * half_height));
+        key = frame_hash(key, (int) (meter_norm(levels.peak_db[c]) * half_height));
+    }
+    key = frame_hash(key, (int) (meter_norm(levels.loudness) * half_height));
+    return key;
+}
+
+bool app_should_draw(AppState * state)
+{
+    AppPowerState * p = &state->power;
+    p->loops++;
+    if (p->state == POWER_BACKGROUND) return false; // Nobody can see it
+
+    const unsigned int key = frame_key(state);
+    if (key == p->key && ! p->input) return false;
+
+    p->key = key;
+    p->drawn++;
+    return true;
+}
+
+void app_wait(AppState * state)
+{
+    switch (state->power.state) {
+    case POWER_SLEEP:
+        break; // Event waiting: PollInputEvents() blocks until something happens
+    case POWER_IDLE:
+        WaitTime(IDLE_TICK);
+        break;
+    case POWER_UNFOCUSED:
+        WaitTime(1.0 / UNFOCUSED_FPS);
+        break;
+    default:
+        WaitTime(1.0 / ACTIVE_FPS); // Keeps UpdateMusicStream() on the same cadence as a drawn frame
+        break;
+    }
+    PollInputEvents();
 }
@@ -2,59 +2,146 @@
 #define APP_H_
 
 #include <complex.h>
+#include <stddef.h>
 #include <raylib.h>
 
-#define MAX_STRING_LENGHT 100
-
+#include "analysis.h"
+#include "arena.h"
+#include "capture.h"
+#include "meter.h"
+#include "normalize.h"
+#include "onset.h"
+#include "overview.h"
+#include "pcm.h"
+#include "publish.h"
+#include "spectrogram.h"
+#include "textcache.h"
+
+// UI strings, each one retained as a texture and only rasterized again when its content changes
 typedef struct {
-    char title[MAX_STRING_LENGHT];
-    char vol_time[MAX_STRING_LENGHT];
-    char play_state[MAX_STRING_LENGHT];
-    char n_str[MAX_STRING_LENGHT];
-    char drag_txt[MAX_STRING_LENGHT];
+    CachedText title;
+    CachedText vol_time;
+    CachedText play_state;
+    CachedText n_str;
+    CachedText bpm;
+    CachedText drag_txt;
+    CachedText error;
+    int vol_shown;       // Volume (%) vol_time was last formatted with
+    int time_shown;      // Music time (s) vol_time was last formatted with
+    int bpm_shown;       // Tempo bpm was last formatted with (0 for none)
 } AppStrings;
 
+typedef enum {
+    VIEW_BARS,           // Instantaneous bar chart
+    VIEW_SPECTROGRAM,    // Scrolling waterfall
+} AppView;
+
+// What the main loop does each iteration, picked from the playback and window state
+typedef enum {
+    POWER_ACTIVE,        // Playing and visible: analysis, redraw when something changed, 60 FPS
+    POWER_UNFOCUSED,     // Playing and visible but another window has focus: same at 30 FPS
+    POWER_BACKGROUND,    // Playing and minimized: no analysis or drawing, the loop only feeds the music stream
+    POWER_IDLE,          // Nothing playing, a background job is still running: poll at 10 Hz
+    POWER_SLEEP,         // Nothing playing or running: block until an input event
+    POWER_COUNT,
+} AppPower;
+
+typedef struct {
+    AppPower state;
+    double since;        // Wall clock (s) when the state was entered
+    double cpu_since;    // Process CPU time (s) when the state was entered
+    unsigned int loops;  // Main loop iterations in this state
+    unsigned int drawn;  // Iterations that drew a frame
+    unsigned int key;    // Signature of everything the last drawn frame shows
+    bool input;          // Input arrived this iteration (always redraw)
+} AppPowerState;
+
 typedef struct {
     bool has_error;      // Error state
     char message[1024];      // Error message
 } AppError;
 
+#define CACHE_LINE 64 // Bytes, keep data written by different threads on different lines
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE)))
+
+// Consumer: hot per frame state of the render thread
 typedef struct {
+    Analysis analysis;   // Window, FFT and bands of frame (buffers live in the arena)
+    float * frame;       // The N captured samples ending at the heard one (arena)
+    size_t hop;          // Analysis hop (frames): windows end on multiples of it, whatever the frame rate
+    size_t analyzed;     // Stream position the last window ended at (same position, no FFT)
+    float played;        // Last GetMusicTimePlayed()
+    double played_wall;  // GetTime() when played last moved (the clock runs on between mixer reads)
+    double stream_pos;   // Raw PCM input: position the wall clock reached, held back to the captured end
+    size_t loops;        // Times a looping track wrapped: capture positions keep counting, played restarts
+    float av_lead_ms;    // Newest captured sample ahead of the heard one (how early the bars were before)
+    float av_error_ms;   // Window end minus the heard sample (0 unless the ring could not serve it)
+    unsigned int frames; // Analysis frames so far (redraw tracking)
+    double update_time;  // GetTime() of the last analysis update (smoothing dt, frames can be skipped)
+    float curr_time;     // Music time shown on the UI
+    Normalizer norm;     // Band level (dBFS) to bar height
+    Onset onset;         // Spectral flux onsets, tempo and beat phase of the analysis frames
+} CACHE_ALIGNED AppRender;
+
+typedef struct {
+    Capture capture;     // Audio thread region: left channel ring tagged with stream positions
+    Meter meter;         // Audio thread level meter (levels published on their own line)
+    AppRender render;    // Render thread region
+
+    // Cold: UI and config (written on load, key press and file drop) -------------------------------
+    Arena arena;         // Owns every analysis buffer, rebuilt as a unit when N or the track changes
+    size_t n;            // The size of input and output buffers
+    float latency;       // Output latency (s) between the mixer and the speakers, compensated in the analysis
+    bool profiler;       // Profiler overlay (dev builds, P toggles)
+
     float width;         // Window width
     float height;        // Window height
 
     Font font;           // Font loaded to be used on drawing
 
     float curr_volume;   // Music current volume
-    float curr_time;
     float music_len;     // Music total length
     Music music;         // Main music
+    PcmInput * pcm;      // Raw PCM input feeding the capture ring instead of the music (NULL when playing a file)
+    bool pcm_paused;     // Space on a raw stream: the clock stops and the reader blocks once the ring is full
 
-    float * in1;          // Input buffer for audio samples (left channel)
-    float * in2;
-    float complex * out; // Output buffer for FFT
-    size_t n;            // The size of input and output buffers
-    size_t in_size;      // Track filled part of input buffer
-
-    float samples[1024]; // samples data arr for the audio callback
-
-    float lowf;          // The low frequency that is the base for calculations
-    float step;          // Constant from Frequency Table Formula
-    size_t m;            // Number of frequencies in the interval
-
-    unsigned int skip_c; // Counter to skip frames
+    Overview overview;   // Whole track seek bar, built in the background on load
+    AppView view;        // What is drawn above the UI (S switches)
+    Spectrogram spectrogram;
 
     AppStrings str;     // Holds the string to UI
 
     AppError error;     // Holds error state and message
-} AppState;
+
+    AppPowerState power; // Main loop pacing and its CPU usage
+    Publisher publisher; // Spectrum frames for other local processes (shared memory, closed unless --publish)
+} CACHE_ALIGNED AppState;
+
+// Each region must start on its own cache line and the audio thread data must fit in one
+_Static_assert(sizeof(Capture) == CACHE_LINE, "Capture must fit in one cache line");
+_Static_assert(offsetof(AppState, capture) % CACHE_LINE == 0, "AppState capture must be cache aligned");
+_Static_assert(offsetof(AppState, meter) % CACHE_LINE == 0, "AppState meter must be cache aligned");
+_Static_assert(offsetof(AppState, render) % CACHE_LINE == 0, "AppState render must be cache aligned");
+_Static_assert(offsetof(AppState, arena) % CACHE_LINE == 0, "AppState cold data must be cache aligned");
 
 AppState * app_init(const char * file_path);
 
+// Visualize raw PCM instead of a file (app_init(NULL) first). The app owns pcm from here and closes it
+void app_stream(AppState * state, PcmInput * pcm);
+
+// Publish every analysis frame to the shared memory segment /name, also while minimized
+void app_publish(AppState * state, const char * name);
+
 void app_update(AppState * state);
 
+// False when the frame would look exactly like the one on screen (or cannot be seen): skip drawing, app_wait()
+bool app_should_draw(AppState * state);
+
 void app_draw(AppState * state);
 
+// Pace an iteration that did not draw (EndDrawing() would have) and poll input, blocking while asleep
+void app_wait(AppState * state);
+
 void app_unload_and_close(AppState * state);
 
 #endif // APP_H_
@@ -0,0 +1,56 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+#include "logger.h"
+
+bool arena_reserve(Arena * arena, size_t capacity)
+{
+    capacity = ARENA_ALIGN(capacity);
+
+    if (arena->base != NULL && arena->capacity >= capacity) {
+        arena_reset(arena);
+        return true;
+    }
+
+    arena_free(arena);
+
+    // One anonymous mapping: page aligned and already zeroed by the kernel
+    void * base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        log_error("Could not map %zu bytes for the arena", capacity);
+        return false;
+    }
+
+    arena->base = base;
+    arena->capacity = capacity;
+    arena->used = 0;
+    return true;
+}
+
+void * arena_alloc(Arena * arena, size_t size)
+{
+    size = ARENA_ALIGN(size);
+    if (arena->base == NULL || size > arena->capacity - arena->used) return NULL;
+
+    void * ptr = arena->base + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+void arena_reset(Arena * arena)
+{
+    if (arena->base == NULL) return;
+    memset(arena->base, 0, arena->used);
+    arena->used = 0;
+}
+
+void arena_free(Arena * arena)
+{
+    if (arena->base != NULL) munmap(arena->base, arena->capacity);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT 64 // Cache line size, every allocation starts on its own line
+
+// Round size up to the arena alignment (use it to sum up the capacity needed for a set of buffers)
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1))
+
+typedef struct {
+    unsigned char * base; // Start of the mapping (page aligned)
+    size_t capacity;      // Bytes mapped
+    size_t used;          // Bytes handed out since the last reset
+} Arena;
+
+// Make sure the arena can hold capacity bytes and reset it. Maps a new block only when the current one is too
+// small, otherwise the old block is reused. Returns false if the mapping fails
+bool arena_reserve(Arena * arena, size_t capacity);
+
+// Zeroed, ARENA_ALIGNMENT aligned block of size bytes. Returns NULL when the arena is out of space
+void * arena_alloc(Arena * arena, size_t size);
+
+// Hand out the whole block again from the start (memory is zeroed)
+void arena_reset(Arena * arena);
+
+// Unmap the block
+void arena_free(Arena * arena);
+
+#endif // ARENA_H_
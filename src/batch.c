@@ -0,0 +1,269 @@
+#define _DEFAULT_SOURCE // strdup
+
+#include <errno.h>
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "analysis.h"
+#include "arena.h"
+#include "batch.h"
+#include "clock.h"
+#include "export.h"
+#include "logger.h"
+#include "onset.h"
+#include "pool.h"
+
+#define BATCH_N ((size_t) 2 << 9) // Same N as the visualizer
+#define BATCH_HOP (BATCH_N / 2)   // 50% overlap
+
+typedef struct {
+    char * path;
+    char out_path[1024];
+    double seconds;               // Audio analyzed, set by the task
+    float bpm;                    // Tempo at the end of the track
+    size_t frames;                // Analysis frames
+    size_t gated;                 // of which were silent and skipped the FFT
+    bool ok;
+} BatchJob;
+
+// One track, start to end. Only touches its own job and locals, so any number run at once
+static void analyze_track(void * arg, size_t worker)
+{
+    BatchJob * job = arg;
+    (void) worker;
+
+    Wave wave = LoadWave(job->path);
+    if (! IsWaveReady(wave)) {
+        log_error("Could not decode: %s", job->path);
+        return;
+    }
+    float * samples = LoadWaveSamples(wave);
+    const size_t frames = wave.frameCount;
+    const unsigned int channels = wave.channels;
+    const unsigned int sample_rate = wave.sampleRate;
+    UnloadWave(wave);
+
+    // Left channel, like the visualizer, contiguous so every analysis frame is a plain pointer into it
+    float * left = malloc(frames * sizeof(float));
+    if (samples == NULL || left == NULL) {
+        log_error("Out of memory decoding: %s", job->path);
+        UnloadWaveSamples(samples);
+        free(left);
+        return;
+    }
+    for (size_t i = 0; i < frames; i++) left[i] = samples[i * channels];
+    UnloadWaveSamples(samples);
+
+    Arena arena = { 0 };
+    Analysis analysis;
+    Onset * onset = malloc(sizeof(Onset)); // Holds the onset history, too big for a worker stack
+    Exporter ex;
+    const size_t capacity = analysis_arena_size(BATCH_N, ANALYSIS_LOWF, ANALYSIS_STEP) + onset_arena_size(BATCH_N / 2);
+    if (onset == NULL || ! arena_reserve(&arena, capacity) ||
+        ! analysis_init(&analysis, &arena, BATCH_N, ANALYSIS_LOWF, ANALYSIS_STEP) ||
+        ! onset_init(onset, &arena, BATCH_N / 2) ||
+        ! export_open(&ex, job->out_path, sample_rate, BATCH_N, BATCH_HOP, analysis.m)) {
+        arena_free(&arena);
+        free(onset);
+        free(left);
+        return;
+    }
+
+    // Energy of the window slides with it: the hop that leaves goes out, the one that enters comes in
+    double energy = 0.0;
+    for (size_t i = 0; i < BATCH_N && i < frames; i++) energy += left[i] * left[i];
+
+    const float hop_seconds = (float) BATCH_HOP / sample_rate;
+    bool ok = true;
+    for (size_t pos = 0; ok && pos + BATCH_N <= frames; pos += BATCH_HOP) {
+        analysis_frame_gated(&analysis, left + pos, energy > 0.0 ? energy : 0.0);
+        for (size_t i = pos; i < pos + BATCH_HOP; i++) energy -= left[i] * left[i];
+        for (size_t i = pos + BATCH_N; i < pos + BATCH_N + BATCH_HOP && i < frames; i++) energy += left[i] * left[i];
+
+        onset_process(onset, analysis.power, pos == 0 ? 0.0f : hop_seconds);
+        const ExportBeat beat = { onset->strength, onset->beat_phase, onset->bpm };
+        ok = export_frame(&ex, analysis.bands, &beat);
+    }
+    job->bpm = onset->bpm;
+    job->frames = analysis.frames;
+    job->gated = analysis.gated;
+
+    if (! export_close(&ex)) ok = false;
+    arena_free(&arena);
+    free(onset);
+    free(left);
+
+    if (! ok) {
+        log_error("Could not write: %s", job->out_path);
+        return;
+    }
+    job->seconds = (double) frames / sample_rate;
+    job->ok = true;
+}
+
+// Track path relative to the input it was found under: the file name for a file given directly, the path below
+// the directory otherwise (raylib lists "<dir>/<sub>/<file>")
+static const char * relative_path(const char * track, const char * input, bool is_dir)
+{
+    const size_t len = strlen(input);
+    if (! is_dir || strncmp(track, input, len) != 0) return GetFileName(track);
+    track += len;
+    while (*track == '/') track++;
+    return track;
+}
+
+// Append path, or every music file under it when it is a directory. Outputs mirror the tree below the input:
+// <out_dir>/<relative path>.analysis, so a/01.flac and b/01.flac do not meet in one file
+static bool collect(const char * path, const char * out_dir, BatchJob ** jobs, size_t * count, size_t * capacity)
+{
+    FilePathList list = { 0 };
+    const bool is_dir = DirectoryExists(path);
+    if (is_dir) {
+        list = LoadDirectoryFilesEx(path, BATCH_EXTENSIONS, true);
+    } else if (! FileExists(path)) {
+        log_warn("Skipping missing path: %s", path);
+        return true;
+    }
+
+    const size_t n = is_dir ? list.count : 1;
+    for (size_t i = 0; i < n; i++) {
+        if (*count == *capacity) {
+            *capacity = *capacity == 0 ? 64 : *capacity * 2;
+            *jobs = realloc(*jobs, *capacity * sizeof(BatchJob));
+            if (*jobs == NULL) {
+                fprintf(stderr, "Out of memory");
+                exit(1);
+            }
+        }
+        BatchJob * job = &(*jobs)[(*count)++];
+        memset(job, 0, sizeof(*job));
+        job->path = strdup(is_dir ? list.paths[i] : path);
+        if (job->path == NULL) {
+            fprintf(stderr, "Out of memory");
+            exit(1);
+        }
+        const int len = snprintf(job->out_path, sizeof(job->out_path), "%s/%s.analysis", out_dir,
+                                 relative_path(job->path, path, is_dir));
+        if (len < 0 || (size_t) len >= sizeof(job->out_path)) {
+            log_error("Output path too long for: %s", job->path);
+            if (is_dir) UnloadDirectoryFiles(list);
+            return false;
+        }
+    }
+
+    if (is_dir) UnloadDirectoryFiles(list);
+    return true;
+}
+
+// Create every directory above file (mkdir -p of its parent)
+static bool make_parents(const char * file)
+{
+    char dir[sizeof(((BatchJob *) 0)->out_path)];
+    strncpy(dir, file, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    for (char * slash = strchr(dir + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+            log_error("Could not create the output directory: %s", dir);
+            return false;
+        }
+        *slash = '/';
+    }
+    return true;
+}
+
+static int compare_out_path(const void * a, const void * b)
+{
+    return strcmp((*(const BatchJob * const *) a)->out_path, (*(const BatchJob * const *) b)->out_path);
+}
+
+// Two jobs writing one file from two workers would corrupt it: refuse the run (the same track given twice, or a
+// file next to a directory that holds one of the same name)
+static bool unique_outputs(BatchJob * jobs, size_t count)
+{
+    BatchJob ** sorted = malloc(count * sizeof(BatchJob *));
+    if (sorted == NULL) return false;
+    for (size_t i = 0; i < count; i++) sorted[i] = &jobs[i];
+    qsort(sorted, count, sizeof(BatchJob *), compare_out_path);
+
+    bool unique = true;
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(sorted[i - 1]->out_path, sorted[i]->out_path) == 0) {
+            log_error("%s and %s would both write %s", sorted[i - 1]->path, sorted[i]->path, sorted[i]->out_path);
+            unique = false;
+        }
+    }
+    free(sorted);
+    return unique;
+}
+
+static void free_jobs(BatchJob * jobs, size_t count)
+{
+    for (size_t i = 0; i < count; i++) free(jobs[i].path);
+    free(jobs);
+}
+
+int batch_run(const char * out_dir, int count, char ** paths)
+{
+    SetTraceLogLevel(LOG_WARNING); // Raylib logs every decoded file otherwise
+
+    if (mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        log_error("Could not create the output directory: %s", out_dir);
+        return 1;
+    }
+
+    BatchJob * jobs = NULL;
+    size_t jobs_count = 0, capacity = 0;
+    bool ok = true;
+    for (int i = 0; ok && i < count; i++) ok = collect(paths[i], out_dir, &jobs, &jobs_count, &capacity);
+    if (ok && jobs_count == 0) {
+        log_error("No tracks to analyze");
+        ok = false;
+    }
+    ok = ok && unique_outputs(jobs, jobs_count);
+    for (size_t i = 0; ok && i < jobs_count; i++) ok = make_parents(jobs[i].out_path);
+
+    Pool pool;
+    if (ok && ! pool_init(&pool, 0)) {
+        log_error("Could not start the thread pool");
+        ok = false;
+    }
+    if (! ok) {
+        free_jobs(jobs, jobs_count);
+        return 1;
+    }
+    log_info("Analyzing %zu tracks on %zu workers", jobs_count, pool.workers);
+
+    const double start = clock_seconds();
+    // A job the pool could not take keeps ok false and is counted as failed below
+    for (size_t i = 0; i < jobs_count; i++) pool_submit(&pool, analyze_track, &jobs[i]);
+    pool_wait(&pool);
+    const double wall = clock_seconds() - start;
+    pool_free(&pool);
+
+    double seconds = 0.0;
+    size_t failed = 0, frames = 0, gated = 0;
+    for (size_t i = 0; i < jobs_count; i++) {
+        if (jobs[i].ok) {
+            seconds += jobs[i].seconds;
+            frames += jobs[i].frames;
+            gated += jobs[i].gated;
+            log_info("%s: %.1f BPM", jobs[i].path, jobs[i].bpm);
+        } else {
+            failed++;
+        }
+    }
+    free_jobs(jobs, jobs_count);
+
+    const double hours = seconds / 3600.0;
+    log_info("%zu tracks (%zu failed), %.2f audio hours in %.2f s: %.2f audio hours per minute",
+             jobs_count - failed, failed, hours, wall, wall > 0 ? hours / (wall / 60.0) : 0.0);
+    if (frames > 0) {
+        log_info("%zu of %zu frames gated as silence (%.1f%%, no FFT)", gated, frames, 100.0 * gated / frames);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#define BATCH_EXTENSIONS ".wav;.mp3;.ogg;.flac;.qoa" // Files picked up when a directory is given
+
+// Offline analysis of many tracks: $ musializer --batch <out_dir> <dir|file>...
+// Tracks are decoded and analyzed concurrently on a work stealing pool (one worker per core), each one writes
+// <out_dir>/<path below its input>.analysis (see export.h): the file name for a file, the tree below a directory.
+// Fails before analyzing anything when two tracks would write the same file. Returns the process exit code
+int batch_run(const char * out_dir, int count, char ** paths);
+
+#endif // BATCH_H_
@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include "capture.h"
+
+// Power of two that fits n plus the slack
+static size_t capture_capacity(size_t n)
+{
+    size_t capacity = 1;
+    while (capacity < n + CAPTURE_SLACK) capacity <<= 1;
+    return capacity;
+}
+
+size_t capture_arena_size(size_t n)
+{
+    const size_t capacity = capture_capacity(n);
+    return ARENA_ALIGN(capacity * sizeof(float))   // samples
+         + ARENA_ALIGN(capacity * sizeof(double)); // energy
+}
+
+bool capture_init(Capture * capture, Arena * arena, size_t n)
+{
+    const size_t capacity = capture_capacity(n);
+    capture->samples = (float *) arena_alloc(arena, capacity * sizeof(float));
+    capture->energy = (double *) arena_alloc(arena, capacity * sizeof(double));
+    if (capture->samples == NULL || capture->energy == NULL) return false;
+
+    capture->mask = capacity - 1;
+    capture_reset(capture, 0, NULL, 0);
+    return true;
+}
+
+void capture_reset(Capture * capture, size_t position, const float * history, size_t count)
+{
+    const size_t keep = capture->mask + 1 - CAPTURE_MARGIN;
+    if (count > keep) {
+        history += count - keep;
+        count = keep;
+    }
+    if (count > position) {
+        history += count - position;
+        count = position;
+    }
+
+    capture->start = position - count;
+    capture->end = capture->start;
+    capture->total = 0.0;
+    if (count > 0) capture_push(capture, history, count, 1);
+}
+
+void capture_push(Capture * capture, const float * data, size_t frames, size_t channels)
+{
+    const size_t end = capture->end;
+    double total = capture->total;
+    for (size_t i = 0; i < frames; i++) {
+        const float x = data[i * channels];
+        const size_t slot = (end + i) & capture->mask;
+        total += (double) x * x;
+        capture->samples[slot] = x;
+        capture->energy[slot] = total;
+    }
+    capture->total = total;
+
+    // Samples and sums first, then the position that makes them visible
+    __atomic_store_n(&capture->end, end + frames, __ATOMIC_RELEASE);
+}
+
+size_t capture_end(const Capture * capture)
+{
+    return __atomic_load_n(&capture->end, __ATOMIC_ACQUIRE);
+}
+
+// Sum of squares of the samples before position (0 up to start)
+static double energy_before(const Capture * capture, size_t position)
+{
+    return position > capture->start ? capture->energy[(position - 1) & capture->mask] : 0.0;
+}
+
+bool capture_window(const Capture * capture, size_t end, size_t n, float * out, double * energy)
+{
+    const size_t keep = capture->mask + 1 - CAPTURE_MARGIN;
+    const size_t newest = capture_end(capture);
+    if (end > newest) return false;
+
+    // [first, end) in the ring, the rest of the n samples is silence before the start
+    size_t first = end > n ? end - n : 0;
+    if (first < capture->start) first = capture->start;
+    if (first > end) first = end;
+    const size_t lo = newest > keep ? newest - keep : 0;
+    if (first < lo) return false; // Overwritten
+
+    const size_t silent = n - (end - first);
+    memset(out, 0, silent * sizeof(float));
+    for (size_t p = first; p < end; p++) out[silent + (p - first)] = capture->samples[p & capture->mask];
+    *energy = energy_before(capture, end) - energy_before(capture, first);
+    if (*energy < 0.0) *energy = 0.0;
+
+    // The audio thread kept writing during the copy: the window must still be clear of what it could reach
+    const size_t after = capture_end(capture);
+    return first >= (after > keep ? after - keep : 0);
+}
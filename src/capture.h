@@ -0,0 +1,44 @@
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+#define CAPTURE_SLACK 65536  // Frames kept besides one analysis window (device latency + render stalls)
+#define CAPTURE_MARGIN 16384 // Largest block the audio thread may write while the render thread reads
+
+// Ring of the captured left channel where every sample is tagged with its stream position (frames since the start
+// of the track, counting on across loops). The render thread picks any window by position, e.g. the one ending at
+// the sample being heard instead of the newest one. A running sum of squares stored next to each sample gives the
+// energy of any window in O(1) (silence gate)
+typedef struct {
+    float * samples;         // capacity, power of two (arena)
+    double * energy;         // Sum of squares of every sample from start up to and including this one (arena)
+    size_t mask;             // capacity - 1
+    size_t start;            // Position of the first sample since the last reset, older ones count as silence
+    double total;            // Sum of squares up to end (audio thread)
+    size_t end;              // Position after the newest sample (stored last, release)
+} __attribute__((aligned(64))) Capture;
+
+size_t capture_arena_size(size_t n);
+
+// Ring for analysis windows of n samples
+bool capture_init(Capture * capture, Arena * arena, size_t n);
+
+// Next sample captured is at position. history holds the count samples right before it (or NULL), so a window can
+// be served right away (call while the audio callback is detached)
+void capture_reset(Capture * capture, size_t position, const float * history, size_t count);
+
+// Append frames interleaved frames, keeping the first channel (audio thread)
+void capture_push(Capture * capture, const float * data, size_t frames, size_t channels);
+
+// Position after the newest sample (render thread)
+size_t capture_end(const Capture * capture);
+
+// Copy the n samples before position end into out and return their energy. Positions before the last reset read
+// as silence. False when the window was not captured yet or was already overwritten
+bool capture_window(const Capture * capture, size_t end, size_t n, float * out, double * energy);
+
+#endif // CAPTURE_H_
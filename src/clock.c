@@ -0,0 +1,12 @@
+#define _DEFAULT_SOURCE // clock_gettime
+
+#include <time.h>
+
+#include "clock.h"
+
+double clock_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,7 @@
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+// Seconds on the monotonic clock (arbitrary origin, never jumps): subtract two readings to time something
+double clock_seconds(void);
+
+#endif // CLOCK_H_
@@ -0,0 +1,97 @@
+#include <string.h>
+
+#include "export.h"
+#include "logger.h"
+
+static FILE * open_stream(const char * path)
+{
+    FILE * file = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+    if (file == NULL) log_error("Could not open the analysis output: %s", path);
+    return file;
+}
+
+// Buffered records only reach the file here: a full disk or a closed pipe shows up in the flush, not in fwrite
+static bool close_stream(FILE * file)
+{
+    if (file == NULL) return true;
+    if (file == stdout) return fflush(stdout) == 0 && ! ferror(stdout);
+    const bool ok = ! ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+// The header is the first write: on failure the stream is closed again, nothing is left open for the caller
+static FILE * write_header(FILE * file, const void * header, size_t size, const char * path)
+{
+    if (fwrite(header, size, 1, file) == 1) return file;
+    log_error("Could not write the analysis header: %s", path);
+    close_stream(file);
+    return NULL;
+}
+
+bool export_open(Exporter * ex, const char * path, uint32_t sample_rate, uint32_t n, uint32_t hop, uint32_t m)
+{
+    memset(ex, 0, sizeof(*ex));
+    ex->file = open_stream(path);
+    if (ex->file == NULL) return false;
+
+    ex->header = (ExportHeader) {
+        .magic = EXPORT_MAGIC,
+        .version = EXPORT_VERSION,
+        .sample_rate = sample_rate,
+        .n = n,
+        .hop = hop,
+        .m = m,
+    };
+    ex->file = write_header(ex->file, &ex->header, sizeof(ex->header), path);
+    return ex->file != NULL;
+}
+
+bool export_frame(Exporter * ex, const float * bands, const ExportBeat * beat)
+{
+    ex->records++;
+    return fwrite(bands, sizeof(float), ex->header.m, ex->file) == ex->header.m &&
+           fwrite(beat, sizeof(*beat), 1, ex->file) == 1;
+}
+
+bool export_close(Exporter * ex)
+{
+    const bool ok = close_stream(ex->file);
+    ex->file = NULL;
+    return ok;
+}
+
+bool export_mel_open(MelExporter * ex, const char * path, uint32_t sample_rate, uint32_t n, uint32_t hop,
+                     uint32_t filters, uint32_t coeffs, float low_hz, float high_hz)
+{
+    memset(ex, 0, sizeof(*ex));
+    ex->file = open_stream(path);
+    if (ex->file == NULL) return false;
+
+    ex->header = (ExportMelHeader) {
+        .magic = EXPORT_MEL_MAGIC,
+        .version = EXPORT_MEL_VERSION,
+        .sample_rate = sample_rate,
+        .n = n,
+        .hop = hop,
+        .filters = filters,
+        .coeffs = coeffs,
+        .low_hz = low_hz,
+        .high_hz = high_hz,
+    };
+    ex->file = write_header(ex->file, &ex->header, sizeof(ex->header), path);
+    return ex->file != NULL;
+}
+
+bool export_mel_frame(MelExporter * ex, const float * log_mel, const float * mfcc)
+{
+    ex->records++;
+    return fwrite(log_mel, sizeof(float), ex->header.filters, ex->file) == ex->header.filters &&
+           fwrite(mfcc, sizeof(float), ex->header.coeffs, ex->file) == ex->header.coeffs;
+}
+
+bool export_mel_close(MelExporter * ex)
+{
+    const bool ok = close_stream(ex->file);
+    ex->file = NULL;
+    return ok;
+}
@@ -0,0 +1,79 @@
+#ifndef EXPORT_H_
+#define EXPORT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define EXPORT_MAGIC 0x4E415A4D // "MZAN"
+#define EXPORT_VERSION 2
+#define EXPORT_MEL_MAGIC 0x464D5A4D // "MZMF"
+#define EXPORT_MEL_VERSION 1
+
+// Header of an analysis stream, followed by one record per analysis frame until EOF:
+//   float bands[m]              band levels in dBFS
+//   ExportBeat beat             onset strength, beat phase and tempo (version 2)
+// All values little endian as written by the host (x86/ARM)
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t n;               // FFT size
+    uint32_t hop;             // Frames between two records
+    uint32_t m;               // Bands per record
+} ExportHeader;
+
+// Beat tracking fields appended to every record (see onset.h)
+typedef struct {
+    float onset_strength;     // Spectral flux
+    float beat_phase;         // [0, 1), 0 on the beat
+    float bpm;                // 0 until the tracker has an estimate
+} ExportBeat;
+
+// Per track analysis output of the headless modes
+typedef struct {
+    FILE * file;
+    ExportHeader header;
+    uint64_t records;
+} Exporter;
+
+// path "-" writes to stdout
+bool export_open(Exporter * ex, const char * path, uint32_t sample_rate, uint32_t n, uint32_t hop, uint32_t m);
+
+bool export_frame(Exporter * ex, const float * bands, const ExportBeat * beat);
+
+// Flush and close. Returns false if buffered records could not be written, the stream is then incomplete
+bool export_close(Exporter * ex);
+
+// Header of a mel feature stream (see mel.h), followed by one fixed size record per analysis frame until EOF, so a
+// whole stream loads as a frames x (filters + coeffs) float matrix:
+//   float log_mel[filters]      filter energies in dBFS
+//   float mfcc[coeffs]          orthonormal DCT-II of log_mel, c0 first
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t n;               // FFT size
+    uint32_t hop;             // Frames between two records
+    uint32_t filters;
+    uint32_t coeffs;
+    float low_hz;             // Lower edge of the first filter
+    float high_hz;            // Upper edge of the last filter
+} ExportMelHeader;
+
+typedef struct {
+    FILE * file;
+    ExportMelHeader header;
+    uint64_t records;
+} MelExporter;
+
+// path "-" writes to stdout
+bool export_mel_open(MelExporter * ex, const char * path, uint32_t sample_rate, uint32_t n, uint32_t hop,
+                     uint32_t filters, uint32_t coeffs, float low_hz, float high_hz);
+
+bool export_mel_frame(MelExporter * ex, const float * log_mel, const float * mfcc);
+
+// Same as export_close()
+bool export_mel_close(MelExporter * ex);
+
+#endif // EXPORT_H_
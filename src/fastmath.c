@@ -0,0 +1,33 @@
+#include <math.h>
+
+#include "fastmath.h"
+
+static unsigned int fast_math = FAST_LOG | FAST_TRIG; // Everything fast by default
+
+bool fast_math_enabled(FastMathFlag flag)
+{
+    return (fast_math & flag) != 0;
+}
+
+void fast_math_toggle(FastMathFlag flag)
+{
+    fast_math ^= flag;
+}
+
+void fast_twiddles(float complex tw[], size_t n)
+{
+    const double pi = 3.14159265358979323846;
+    for (size_t k = 0; k < n / 2; k++) {
+        const double angle = -2.0 * pi * (double) k / (double) n;
+        tw[k] = (float) cos(angle) + (float) sin(angle) * I;
+    }
+}
+
+void fast_hann(float w[], size_t n)
+{
+    const double pi = 3.14159265358979323846;
+    for (size_t i = 0; i < n; i++) {
+        const double t = (double) i / (n - 1);
+        w[i] = (float) (0.5 - 0.5 * cos(2 * pi * t));
+    }
+}
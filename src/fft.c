@@ -0,0 +1,621 @@
+#include <assert.h>
+#include <math.h>
+
+#include "fastmath.h"
+#include "fft.h"
+
+// log2 n when a codelet does the whole transform of n, 0 otherwise
+static size_t codelet_index(size_t n)
+{
+    if (n < 2 || n > FFT_CODELET_MAX || (n & (n - 1)) != 0) return 0;
+    size_t j = 0;
+    while ((size_t) 1 << j < n) j++;
+    return j;
+}
+
+// tw is the twiddle table for the top level size, at every level step == N/n so W_n^k == tw[k * step]
+void fft(float in[], size_t step, float complex out[], size_t n, const float complex tw[])
+{
+    assert(n > 0);
+
+    if (n == 1) {
+        out[0] = in[0];
+        return;
+    }
+    const size_t j = codelet_index(n);
+    if (j > 0) {
+        fft_codelets_real[j](in, step, out, 1);
+        return;
+    }
+
+    fft(in,        step * 2, out,         n / 2, tw);
+    fft(in + step, step * 2, out + n / 2, n / 2, tw);
+
+    if (fast_math_enabled(FAST_TRIG)) {
+        for (size_t k = 0; k < n / 2; k++) {
+            float complex v = tw[k * step] * out[k + n / 2];
+            float complex e = out[k];
+            out[k]         = e + v;
+            out[k + n / 2] = e - v;
+        }
+    } else {
+        for (size_t k = 0; k < n / 2; k++) {
+            float t  = (float) k / n;
+            float complex v = cexpf(-2 * I * FFT_PI * t) * out[k + n / 2];
+            float complex e = out[k];
+            out[k]         = e + v;
+            out[k + n / 2] = e - v;
+        }
+    }
+}
+
+// Mixed radix plan ---------------------------------------------------------------------------------------------------
+
+// i * a
+static inline float complex cmul_i(float complex a)
+{
+    return -cimagf(a) + crealf(a) * I;
+}
+
+// Split n into radices 5, 3, 4 and 2 (4 before 2: fewest stages). The power of 2 part comes last, innermost, so the
+// recursive kernel ends in a codelet. Returns what is left, 1 when n factored completely
+static size_t factor(size_t n, size_t factors[FFT_MAX_FACTORS], size_t * count)
+{
+    static const size_t radices[] = { 5, 3, 4, 2 };
+    *count = 0;
+    for (size_t r = 0; r < sizeof(radices) / sizeof(radices[0]); r++) {
+        while (n % radices[r] == 0 && n > 1 && *count < FFT_MAX_FACTORS) {
+            factors[(*count)++] = radices[r];
+            n /= radices[r];
+        }
+    }
+    return n;
+}
+
+// Smallest power of 2 holding the linear convolution of two n long sequences
+static size_t bluestein_size(size_t n)
+{
+    size_t m = 1;
+    while (m < 2 * n - 1) m <<= 1;
+    return m;
+}
+
+size_t fft_plan_arena_size(size_t n)
+{
+    size_t factors[FFT_MAX_FACTORS];
+    size_t count;
+    size_t size = ARENA_ALIGN(n * sizeof(float complex))  // tw
+                + ARENA_ALIGN(n * sizeof(float complex)); // buf
+    if (factor(n, factors, &count) == 1) return size;
+
+    const size_t m = bluestein_size(n);
+    return size + ARENA_ALIGN(sizeof(FftPlan))            // sub
+                + fft_plan_arena_size(m)
+                + ARENA_ALIGN(n * sizeof(float complex))  // chirp
+                + 3 * ARENA_ALIGN(m * sizeof(float complex)); // kernel, work, work_out
+}
+
+bool fft_plan_init(FftPlan * plan, Arena * arena, size_t n)
+{
+    const double pi = 3.14159265358979323846;
+    assert(n > 0);
+
+    *plan = (FftPlan) { .n = n, .kernel = FFT_KERNEL_STOCKHAM };
+    plan->bluestein = factor(n, plan->factors, &plan->factor_count) != 1;
+    plan->tw = (float complex *) arena_alloc(arena, n * sizeof(float complex));
+    plan->buf = (float complex *) arena_alloc(arena, n * sizeof(float complex));
+    if (plan->tw == NULL || plan->buf == NULL) return false;
+
+    // Whole circle, every radix reads W^(k*q) with k*q up to n - 1
+    for (size_t k = 0; k < n; k++) {
+        const double angle = -2.0 * pi * (double) k / (double) n;
+        plan->tw[k] = (float) cos(angle) + (float) sin(angle) * I;
+    }
+    if (! plan->bluestein) return true;
+
+    const size_t m = bluestein_size(n);
+    plan->m = m;
+    plan->sub = (FftPlan *) arena_alloc(arena, sizeof(FftPlan));
+    if (plan->sub == NULL || ! fft_plan_init(plan->sub, arena, m)) return false;
+    plan->chirp = (float complex *) arena_alloc(arena, n * sizeof(float complex));
+    plan->response = (float complex *) arena_alloc(arena, m * sizeof(float complex));
+    plan->work = (float complex *) arena_alloc(arena, m * sizeof(float complex));
+    plan->work_out = (float complex *) arena_alloc(arena, m * sizeof(float complex));
+    if (plan->chirp == NULL || plan->response == NULL || plan->work == NULL || plan->work_out == NULL) return false;
+
+    // k^2 taken mod 2n so the angle stays small and exact in double for any n
+    for (size_t k = 0; k < n; k++) {
+        const double angle = -pi * (double) ((k * k) % (2 * n)) / (double) n;
+        plan->chirp[k] = (float) cos(angle) + (float) sin(angle) * I;
+    }
+
+    // Conjugate chirp wrapped around (negative lags at the end), transformed once. 1/m of the inverse folded in
+    for (size_t j = 0; j < n; j++) {
+        plan->work[j] = conjf(plan->chirp[j]);
+        if (j > 0) plan->work[m - j] = conjf(plan->chirp[j]);
+    }
+    fft_plan_complex(plan->sub, plan->work, plan->response);
+    for (size_t k = 0; k < m; k++) plan->response[k] /= (float) m;
+    return true;
+}
+
+static void butterfly2(float complex * out, size_t fstride, const float complex * tw, size_t m)
+{
+    for (size_t k = 0; k < m; k++) {
+        const float complex t = cmul(out[k + m], tw[k * fstride]);
+        out[k + m] = out[k] - t;
+        out[k] += t;
+    }
+}
+
+static void butterfly3(float complex * out, size_t fstride, const float complex * tw, size_t m)
+{
+    const float epi3 = cimagf(tw[fstride * m]); // sin(-2*pi/3)
+    for (size_t k = 0; k < m; k++) {
+        const float complex s1 = cmul(out[k + m], tw[k * fstride]);
+        const float complex s2 = cmul(out[k + 2 * m], tw[2 * k * fstride]);
+        const float complex sum = s1 + s2;
+        const float complex diff = (s1 - s2) * epi3;
+        const float complex half = out[k] - sum * 0.5f;
+        out[k] += sum;
+        out[k + m] = half + cmul_i(diff);
+        out[k + 2 * m] = half - cmul_i(diff);
+    }
+}
+
+static void butterfly4(float complex * out, size_t fstride, const float complex * tw, size_t m)
+{
+    for (size_t k = 0; k < m; k++) {
+        const float complex s0 = cmul(out[k + m], tw[k * fstride]);
+        const float complex s1 = cmul(out[k + 2 * m], tw[2 * k * fstride]);
+        const float complex s2 = cmul(out[k + 3 * m], tw[3 * k * fstride]);
+        const float complex a = out[k] + s1;
+        const float complex b = out[k] - s1;
+        const float complex c = s0 + s2;
+        const float complex d = cmul_i(s0 - s2);
+        out[k] = a + c;
+        out[k + m] = b - d;
+        out[k + 2 * m] = a - c;
+        out[k + 3 * m] = b + d;
+    }
+}
+
+static void butterfly5(float complex * out, size_t fstride, const float complex * tw, size_t m)
+{
+    const float complex ya = tw[fstride * m];     // W^1 of this stage
+    const float complex yb = tw[fstride * 2 * m]; // W^2
+    for (size_t k = 0; k < m; k++) {
+        const float complex s0 = out[k];
+        const float complex s1 = cmul(out[k + m], tw[k * fstride]);
+        const float complex s2 = cmul(out[k + 2 * m], tw[2 * k * fstride]);
+        const float complex s3 = cmul(out[k + 3 * m], tw[3 * k * fstride]);
+        const float complex s4 = cmul(out[k + 4 * m], tw[4 * k * fstride]);
+
+        const float complex s7 = s1 + s4, s10 = s1 - s4;
+        const float complex s8 = s2 + s3, s9 = s2 - s3;
+
+        const float complex s5 = s0 + s7 * crealf(ya) + s8 * crealf(yb);
+        const float complex s6 = cmul_i(s10 * cimagf(ya) + s9 * cimagf(yb));
+        const float complex s11 = s0 + s7 * crealf(yb) + s8 * crealf(ya);
+        const float complex s12 = cmul_i(s10 * cimagf(yb) - s9 * cimagf(ya));
+
+        out[k] = s0 + s7 + s8;
+        out[k + m] = s5 + s6;
+        out[k + 4 * m] = s5 - s6;
+        out[k + 2 * m] = s11 + s12;
+        out[k + 3 * m] = s11 - s12;
+    }
+}
+
+// Decimation in time: the p sub transforms of the inputs q, q + p, q + 2p... land side by side in out, then one
+// butterfly pass of radix p combines them. fstride is n_plan / n at this level, W_n^k == tw[k * fstride]
+static void mixed_work(const FftPlan * plan, float complex * out, const float complex * in, size_t fstride,
+                       const size_t * factors, size_t n)
+{
+    const size_t j = codelet_index(n);
+    if (j > 0) {
+        fft_codelets[j](in, fstride, out, 1);
+        return;
+    }
+
+    const size_t p = factors[0];
+    const size_t m = n / p;
+
+    if (m == 1) {
+        for (size_t q = 0; q < p; q++) out[q] = in[q * fstride];
+    } else {
+        for (size_t q = 0; q < p; q++) mixed_work(plan, out + q * m, in + q * fstride, fstride * p, factors + 1, m);
+    }
+
+    switch (p) {
+    case 2: butterfly2(out, fstride, plan->tw, m); break;
+    case 3: butterfly3(out, fstride, plan->tw, m); break;
+    case 4: butterfly4(out, fstride, plan->tw, m); break;
+    case 5: butterfly5(out, fstride, plan->tw, m); break;
+    default: assert(0 && "unreachable: factor() only emits 2, 3, 4 and 5");
+    }
+}
+
+// X_k = c_k * x_k * sum_j (x_j * c_j) * conj(c_(k-j)) with c_k = e^(-i*pi*k^2/n): one power of 2 convolution
+static void bluestein(const FftPlan * plan, const float complex * in, float complex * out)
+{
+    const size_t n = plan->n;
+    const size_t m = plan->m;
+
+    for (size_t j = 0; j < n; j++) plan->work[j] = cmul(in[j], plan->chirp[j]);
+    for (size_t j = n; j < m; j++) plan->work[j] = 0.0f;
+    fft_plan_complex(plan->sub, plan->work, plan->work_out);
+
+    // Inverse transform as conj(FFT(conj(x))), the 1/m is in the response
+    for (size_t k = 0; k < m; k++) plan->work[k] = conjf(cmul(plan->work_out[k], plan->response[k]));
+    fft_plan_complex(plan->sub, plan->work, plan->work_out);
+
+    for (size_t k = 0; k < n; k++) out[k] = cmul(conjf(plan->work_out[k]), plan->chirp[k]);
+}
+
+// Stockham autosort ----------------------------------------------------------------------------------------------
+//
+// Pass of radix p over s interleaved sub transforms of length m * p: reads x[k + s * (j + q * m)], writes
+// y[k + s * (p * j + r)] already multiplied by the twiddle W^(j * r) of the next level. k is the inner loop so both
+// sides stream with unit stride, and the output of the last pass is in natural order (no bit reversal)
+
+#define STOCKHAM_CODELET_MAX_N 4096 // Largest n whose last power of 2 passes are one codelet pass (32 KB of L1)
+
+static void stockham2(const float complex * tw, size_t s, size_t m, const float complex * x, float complex * y)
+{
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s];
+        const float complex * x0 = x + s * j;
+        const float complex * x1 = x + s * (j + m);
+        float complex * y0 = y + s * 2 * j;
+        float complex * y1 = y0 + s;
+        for (size_t k = 0; k < s; k++) {
+            const float complex a = x0[k], b = x1[k];
+            y0[k] = a + b;
+            y1[k] = cmul(a - b, w1);
+        }
+    }
+}
+
+static void stockham3(const float complex * tw, size_t n, size_t s, size_t m, const float complex * x,
+                      float complex * y)
+{
+    const float c = crealf(tw[n / 3]), d = cimagf(tw[n / 3]); // W_3 = -1/2 - i * sqrt(3)/2
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s], w2 = tw[2 * j * s];
+        for (size_t k = 0; k < s; k++) {
+            const float complex a0 = x[k + s * j], a1 = x[k + s * (j + m)], a2 = x[k + s * (j + 2 * m)];
+            const float complex sum = a1 + a2;
+            const float complex rot = cmul_i((a1 - a2) * d);
+            const float complex base = a0 + sum * c;
+            y[k + s * 3 * j] = a0 + sum;
+            y[k + s * (3 * j + 1)] = cmul(base + rot, w1);
+            y[k + s * (3 * j + 2)] = cmul(base - rot, w2);
+        }
+    }
+}
+
+static void stockham4(const float complex * tw, size_t s, size_t m, const float complex * x, float complex * y)
+{
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s], w2 = tw[2 * j * s], w3 = tw[3 * j * s];
+        const float complex * x0 = x + s * j;
+        const float complex * x1 = x + s * (j + m);
+        const float complex * x2 = x + s * (j + 2 * m);
+        const float complex * x3 = x + s * (j + 3 * m);
+        float complex * y0 = y + s * 4 * j;
+        for (size_t k = 0; k < s; k++) {
+            const float complex a0 = x0[k], a1 = x1[k], a2 = x2[k], a3 = x3[k];
+            const float complex t0 = a0 + a2, t1 = a0 - a2;
+            const float complex t2 = a1 + a3, t3 = -cmul_i(a1 - a3);
+            y0[k] = t0 + t2;
+            y0[k + s] = cmul(t1 + t3, w1);
+            y0[k + 2 * s] = cmul(t0 - t2, w2);
+            y0[k + 3 * s] = cmul(t1 - t3, w3);
+        }
+    }
+}
+
+static void stockham5(const float complex * tw, size_t n, size_t s, size_t m, const float complex * x,
+                      float complex * y)
+{
+    const float c1 = crealf(tw[n / 5]), s1 = cimagf(tw[n / 5]);         // W_5
+    const float c2 = crealf(tw[2 * n / 5]), s2 = cimagf(tw[2 * n / 5]); // W_5^2
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s], w2 = tw[2 * j * s], w3 = tw[3 * j * s], w4 = tw[4 * j * s];
+        for (size_t k = 0; k < s; k++) {
+            const float complex a0 = x[k + s * j];
+            const float complex a1 = x[k + s * (j + m)], a4 = x[k + s * (j + 4 * m)];
+            const float complex a2 = x[k + s * (j + 2 * m)], a3 = x[k + s * (j + 3 * m)];
+            const float complex t1 = a1 + a4, d1 = a1 - a4;
+            const float complex t2 = a2 + a3, d2 = a2 - a3;
+            const float complex b1 = a0 + t1 * c1 + t2 * c2, r1 = cmul_i(d1 * s1 + d2 * s2);
+            const float complex b2 = a0 + t1 * c2 + t2 * c1, r2 = cmul_i(d1 * s2 - d2 * s1);
+            float complex * out = y + k + s * 5 * j;
+            out[0] = a0 + t1 + t2;
+            out[s] = cmul(b1 + r1, w1);
+            out[2 * s] = cmul(b2 + r2, w2);
+            out[3 * s] = cmul(b2 - r2, w3);
+            out[4 * s] = cmul(b1 - r1, w4);
+        }
+    }
+}
+
+// Passes of radix p until the s columns left are transforms a codelet does in one more pass (the power of 2 factors
+// are innermost, see factor()). Only while the whole transform stays in L1: a codelet reads its column s values
+// apart, a power of 2 stride that maps every row to the same few cache sets once the data outgrows L1
+static size_t stockham_radix_passes(const FftPlan * plan)
+{
+    if (plan->n > STOCKHAM_CODELET_MAX_N) return plan->factor_count;
+    size_t s = 1, f = 0;
+    while (f < plan->factor_count && codelet_index(plan->n / s) == 0) s *= plan->factors[f++];
+    return f;
+}
+
+// Buffer the first pass writes to: passes alternate between out and buf and the last one must land in out
+static float complex * stockham_first(const FftPlan * plan, float complex * out)
+{
+    const size_t passes = stockham_radix_passes(plan) + (stockham_radix_passes(plan) < plan->factor_count);
+    return passes % 2 == 1 ? out : plan->buf;
+}
+
+// src can be anything but stockham_first()
+static void stockham(const FftPlan * plan, const float complex * src, float complex * out)
+{
+    const size_t n = plan->n;
+    float complex * dst = stockham_first(plan, out);
+    const float complex * x = src;
+    size_t s = 1;
+    const size_t radix_passes = stockham_radix_passes(plan);
+    for (size_t f = 0; f < radix_passes; f++) {
+        const size_t p = plan->factors[f];
+        const size_t m = n / (s * p);
+        switch (p) {
+        case 2: stockham2(plan->tw, s, m, x, dst); break;
+        case 3: stockham3(plan->tw, n, s, m, x, dst); break;
+        case 4: stockham4(plan->tw, s, m, x, dst); break;
+        case 5: stockham5(plan->tw, n, s, m, x, dst); break;
+        default: assert(0 && "unreachable: factor() only emits 2, 3, 4 and 5");
+        }
+        x = dst;
+        dst = dst == out ? plan->buf : out;
+        s *= p;
+    }
+
+    // Column k of the rest is a transform of n / s points, x[k + s * j] to y[k + s * r] like the passes above
+    const size_t j = codelet_index(n / s);
+    if (j > 0) {
+        for (size_t k = 0; k < s; k++) fft_codelets[j](x + k, s, dst + k, s);
+    }
+}
+
+void fft_plan_use(FftPlan * plan, FftKernel kernel)
+{
+    plan->kernel = kernel;
+    if (plan->sub != NULL) fft_plan_use(plan->sub, kernel);
+}
+
+const char * fft_kernel_name(FftKernel kernel)
+{
+    static const char * names[FFT_KERNEL_COUNT] = { "recursive", "stockham" };
+    return kernel < FFT_KERNEL_COUNT ? names[kernel] : "?";
+}
+
+void fft_plan_complex(const FftPlan * plan, const float complex * in, float complex * out)
+{
+    if (plan->bluestein) {
+        bluestein(plan, in, out);
+    } else if (plan->factor_count == 0) {
+        out[0] = in[0]; // n == 1
+    } else if (plan->kernel == FFT_KERNEL_STOCKHAM) {
+        stockham(plan, in, out);
+    } else {
+        mixed_work(plan, out, in, 1, plan->factors, plan->n);
+    }
+}
+
+void fft_plan_real(const FftPlan * plan, const float * in, float complex * out)
+{
+    // Stockham: the complex copy goes straight into the buffer the first pass reads
+    float complex * src = plan->buf;
+    if (! plan->bluestein && plan->factor_count > 0 && plan->kernel == FFT_KERNEL_STOCKHAM) {
+        src = stockham_first(plan, out) == out ? plan->buf : out;
+    }
+    for (size_t i = 0; i < plan->n; i++) src[i] = in[i];
+    fft_plan_complex(plan, src, out);
+}
+
+// Batches ------------------------------------------------------------------------------------------------------------
+//
+// The Stockham passes again, on points that are FFT_BATCH_LANES frames wide: the same indexing with Lanes in place of
+// float, so every line below is one vector operation for all the frames of a group
+
+typedef float Lanes __attribute__((vector_size(FFT_BATCH_LANES * sizeof(float))));
+
+typedef struct {
+    Lanes re;
+    Lanes im;
+} LanesComplex;
+
+static inline LanesComplex lanes_add(LanesComplex a, LanesComplex b)
+{
+    return (LanesComplex) { a.re + b.re, a.im + b.im };
+}
+
+static inline LanesComplex lanes_sub(LanesComplex a, LanesComplex b)
+{
+    return (LanesComplex) { a.re - b.re, a.im - b.im };
+}
+
+static inline LanesComplex lanes_scale(LanesComplex a, float c)
+{
+    return (LanesComplex) { a.re * c, a.im * c };
+}
+
+// i * a
+static inline LanesComplex lanes_mul_i(LanesComplex a)
+{
+    return (LanesComplex) { -a.im, a.re };
+}
+
+// a * w, the same twiddle for every lane
+static inline LanesComplex lanes_mul(LanesComplex a, float complex w)
+{
+    const float wr = crealf(w), wi = cimagf(w);
+    return (LanesComplex) { a.re * wr - a.im * wi, a.re * wi + a.im * wr };
+}
+
+static void lanes2(const float complex * tw, size_t s, size_t m, const LanesComplex * x, LanesComplex * y)
+{
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s];
+        const LanesComplex * x0 = x + s * j;
+        const LanesComplex * x1 = x + s * (j + m);
+        LanesComplex * y0 = y + s * 2 * j;
+        for (size_t k = 0; k < s; k++) {
+            const LanesComplex a = x0[k], b = x1[k];
+            y0[k] = lanes_add(a, b);
+            y0[k + s] = lanes_mul(lanes_sub(a, b), w1);
+        }
+    }
+}
+
+static void lanes3(const float complex * tw, size_t n, size_t s, size_t m, const LanesComplex * x, LanesComplex * y)
+{
+    const float c = crealf(tw[n / 3]), d = cimagf(tw[n / 3]);
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s], w2 = tw[2 * j * s];
+        for (size_t k = 0; k < s; k++) {
+            const LanesComplex a0 = x[k + s * j], a1 = x[k + s * (j + m)], a2 = x[k + s * (j + 2 * m)];
+            const LanesComplex sum = lanes_add(a1, a2);
+            const LanesComplex rot = lanes_mul_i(lanes_scale(lanes_sub(a1, a2), d));
+            const LanesComplex base = lanes_add(a0, lanes_scale(sum, c));
+            LanesComplex * out = y + k + s * 3 * j;
+            out[0] = lanes_add(a0, sum);
+            out[s] = lanes_mul(lanes_add(base, rot), w1);
+            out[2 * s] = lanes_mul(lanes_sub(base, rot), w2);
+        }
+    }
+}
+
+static void lanes4(const float complex * tw, size_t s, size_t m, const LanesComplex * x, LanesComplex * y)
+{
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s], w2 = tw[2 * j * s], w3 = tw[3 * j * s];
+        const LanesComplex * x0 = x + s * j;
+        const LanesComplex * x1 = x + s * (j + m);
+        const LanesComplex * x2 = x + s * (j + 2 * m);
+        const LanesComplex * x3 = x + s * (j + 3 * m);
+        LanesComplex * y0 = y + s * 4 * j;
+        for (size_t k = 0; k < s; k++) {
+            const LanesComplex a0 = x0[k], a1 = x1[k], a2 = x2[k], a3 = x3[k];
+            const LanesComplex t0 = lanes_add(a0, a2), t1 = lanes_sub(a0, a2);
+            const LanesComplex t2 = lanes_add(a1, a3), t3 = lanes_mul_i(lanes_sub(a3, a1));
+            y0[k] = lanes_add(t0, t2);
+            y0[k + s] = lanes_mul(lanes_add(t1, t3), w1);
+            y0[k + 2 * s] = lanes_mul(lanes_sub(t0, t2), w2);
+            y0[k + 3 * s] = lanes_mul(lanes_sub(t1, t3), w3);
+        }
+    }
+}
+
+static void lanes5(const float complex * tw, size_t n, size_t s, size_t m, const LanesComplex * x, LanesComplex * y)
+{
+    const float c1 = crealf(tw[n / 5]), s1 = cimagf(tw[n / 5]);
+    const float c2 = crealf(tw[2 * n / 5]), s2 = cimagf(tw[2 * n / 5]);
+    for (size_t j = 0; j < m; j++) {
+        const float complex w1 = tw[j * s], w2 = tw[2 * j * s], w3 = tw[3 * j * s], w4 = tw[4 * j * s];
+        for (size_t k = 0; k < s; k++) {
+            const LanesComplex a0 = x[k + s * j];
+            const LanesComplex a1 = x[k + s * (j + m)], a4 = x[k + s * (j + 4 * m)];
+            const LanesComplex a2 = x[k + s * (j + 2 * m)], a3 = x[k + s * (j + 3 * m)];
+            const LanesComplex t1 = lanes_add(a1, a4), d1 = lanes_sub(a1, a4);
+            const LanesComplex t2 = lanes_add(a2, a3), d2 = lanes_sub(a2, a3);
+            const LanesComplex b1 = lanes_add(a0, lanes_add(lanes_scale(t1, c1), lanes_scale(t2, c2)));
+            const LanesComplex b2 = lanes_add(a0, lanes_add(lanes_scale(t1, c2), lanes_scale(t2, c1)));
+            const LanesComplex r1 = lanes_mul_i(lanes_add(lanes_scale(d1, s1), lanes_scale(d2, s2)));
+            const LanesComplex r2 = lanes_mul_i(lanes_sub(lanes_scale(d1, s2), lanes_scale(d2, s1)));
+            LanesComplex * out = y + k + s * 5 * j;
+            out[0] = lanes_add(a0, lanes_add(t1, t2));
+            out[s] = lanes_mul(lanes_add(b1, r1), w1);
+            out[2 * s] = lanes_mul(lanes_add(b2, r2), w2);
+            out[3 * s] = lanes_mul(lanes_sub(b2, r2), w3);
+            out[4 * s] = lanes_mul(lanes_sub(b1, r1), w4);
+        }
+    }
+}
+
+static bool batch_in_lanes(const FftPlan * plan)
+{
+    return ! plan->bluestein && plan->factor_count > 0 && plan->n <= FFT_BATCH_MAX_N;
+}
+
+size_t fft_batch_arena_size(size_t n)
+{
+    if (n > FFT_BATCH_MAX_N) return 0;
+    return 2 * ARENA_ALIGN(n * sizeof(LanesComplex)); // a, b
+}
+
+bool fft_batch_init(FftBatch * batch, Arena * arena, const FftPlan * plan)
+{
+    *batch = (FftBatch) { .plan = plan, .lanes = batch_in_lanes(plan) };
+    if (! batch->lanes) return true;
+    batch->a = (float *) arena_alloc(arena, plan->n * sizeof(LanesComplex));
+    batch->b = (float *) arena_alloc(arena, plan->n * sizeof(LanesComplex));
+    return batch->a != NULL && batch->b != NULL;
+}
+
+// width (up to FFT_BATCH_LANES) frames: every pass of the plan between a and b, in and out one lane per frame
+static void batch_group(const FftBatch * batch, const float * in, size_t width, float complex * out)
+{
+    const FftPlan * plan = batch->plan;
+    const size_t n = plan->n;
+    LanesComplex * x = (LanesComplex *) batch->a;
+    LanesComplex * y = (LanesComplex *) batch->b;
+
+    // Unused lanes of a last partial group stay zero, their results are dropped
+    for (size_t i = 0; i < n; i++) {
+        LanesComplex v = { 0 };
+        for (size_t l = 0; l < width; l++) v.re[l] = in[l * n + i];
+        x[i] = v;
+    }
+
+    size_t s = 1;
+    for (size_t f = 0; f < plan->factor_count; f++) {
+        const size_t p = plan->factors[f];
+        const size_t m = n / (s * p);
+        switch (p) {
+        case 2: lanes2(plan->tw, s, m, x, y); break;
+        case 3: lanes3(plan->tw, n, s, m, x, y); break;
+        case 4: lanes4(plan->tw, s, m, x, y); break;
+        case 5: lanes5(plan->tw, n, s, m, x, y); break;
+        default: assert(0 && "unreachable: factor() only emits 2, 3, 4 and 5");
+        }
+        LanesComplex * t = x;
+        x = y;
+        y = t;
+        s *= p;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const LanesComplex v = x[i];
+        for (size_t l = 0; l < width; l++) out[l * n + i] = v.re[l] + v.im[l] * I;
+    }
+}
+
+void fft_batch_real(const FftBatch * batch, const float * in, size_t count, float complex * out)
+{
+    const size_t n = batch->plan->n;
+    if (! batch->lanes) {
+        for (size_t f = 0; f < count; f++) fft_plan_real(batch->plan, in + f * n, out + f * n);
+        return;
+    }
+    for (size_t f = 0; f < count; f += FFT_BATCH_LANES) {
+        const size_t width = count - f < FFT_BATCH_LANES ? count - f : FFT_BATCH_LANES;
+        if (width == 1) {
+            fft_plan_real(batch->plan, in + f * n, out + f * n); // A group of one is all padding
+        } else {
+            batch_group(batch, in + f * n, width, out + f * n);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+#define FFT_PI 3.14159265358979323846f
+#define FFT_MAX_FACTORS 32
+#define FFT_CODELET_LOG2 6
+#define FFT_CODELET_MAX (1 << FFT_CODELET_LOG2) // Largest straight line codelet
+#define FFT_BATCH_LANES 4                       // Frames a batch transforms side by side: one SSE register of floats
+#define FFT_BATCH_MAX_N 65536                   // Largest n a batch runs in lanes (2 * 2 MB of buffers)
+
+// Radix-2 decimation in time FFT of n real samples read every step floats (n must be a power of 2)
+// tw is the twiddle table of the top level size (see fast_twiddles()), start with step = 1
+void fft(float in[], size_t step, float complex out[], size_t n, const float complex tw[]);
+
+// Transform of n = 2^j points read every is values, written every os values (j in [1, FFT_CODELET_LOG2])
+typedef void (* FftCodelet)(const float complex * in, size_t is, float complex * out, size_t os);
+typedef void (* FftCodeletReal)(const float * in, size_t is, float complex * out, size_t os);
+
+// Generated by extra/fft-gen.c into bin/fft_codelets.c at build time: fully unrolled, constant twiddles, indexed by
+// j (entry 0 is NULL). The recursions of fft() and of the plans stop at these instead of going down to n == 1
+extern const FftCodelet fft_codelets[FFT_CODELET_LOG2 + 1];
+extern const FftCodeletReal fft_codelets_real[FFT_CODELET_LOG2 + 1];
+
+// How a plan walks memory. Both give the same bins (within float rounding)
+typedef enum {
+    FFT_KERNEL_RECURSIVE,            // Depth first decimation in time: strided reads (in + q * fstride) at the leaves
+    FFT_KERNEL_STOCKHAM,             // Autosort: every pass streams between two buffers, no reordering pass
+    FFT_KERNEL_COUNT,
+} FftKernel;
+
+// Precomputed transform of any size n: mixed radix decimation in time over the factors 4, 2, 3 and 5, or Bluestein's
+// chirp z (a power of 2 convolution of at least 2n - 1) when n has a larger prime factor. N = 4800 (100 ms at
+// 48 kHz) is 5 * 5 * 3 * 4 * 4 * 4. Everything lives in the arena it was planned in, one plan runs on one thread
+typedef struct FftPlan {
+    size_t n;
+    FftKernel kernel;                // Stockham unless fft_plan_use() picked another one
+    size_t factors[FFT_MAX_FACTORS]; // Radix of each stage, outermost first (none when bluestein)
+    size_t factor_count;
+    float complex * tw;              // e^(-2*pi*i*k/n) for k in [0, n)
+    float complex * buf;             // n, complex copy of a real input, the Stockham ping-pong partner of out
+
+    // Bluestein --------------------------------------------------------------------------------------------------
+    bool bluestein;
+    size_t m;                        // Convolution size (power of 2)
+    struct FftPlan * sub;            // Plan of size m
+    float complex * chirp;           // e^(-i*pi*k^2/n) for k in [0, n)
+    float complex * response;        // FFT of the conjugate chirp wrapped around m, divided by m
+    float complex * work;            // m
+    float complex * work_out;        // m
+} FftPlan;
+
+// Arena bytes fft_plan_init() needs for n
+size_t fft_plan_arena_size(size_t n);
+
+// Factor n and fill the tables. Returns false if the arena is too small
+bool fft_plan_init(FftPlan * plan, Arena * arena, size_t n);
+
+// Switch the kernel (the Bluestein sub plan follows)
+void fft_plan_use(FftPlan * plan, FftKernel kernel);
+
+const char * fft_kernel_name(FftKernel kernel);
+
+// Complex transform of n values, out must not overlap in
+void fft_plan_complex(const FftPlan * plan, const float complex * in, float complex * out);
+
+// Transform of n real samples (all n bins, the upper half mirrors the lower one)
+void fft_plan_real(const FftPlan * plan, const float * in, float complex * out);
+
+// Many frames of one plan at once for the offline modes. FFT_BATCH_LANES frames are interleaved, point i of all of
+// them in one vector of real parts and one of imaginary parts, and go through the Stockham passes together: every
+// butterfly is a handful of vector operations (gcc vector extensions) and every twiddle is loaded once per group
+// instead of once per frame. Larger n and Bluestein plans just loop over fft_plan_real() (sixstep.h for the huge ones)
+typedef struct {
+    const FftPlan * plan;
+    bool lanes;                      // n <= FFT_BATCH_MAX_N and no Bluestein
+    float * a;                       // 2 * FFT_BATCH_LANES * n when lanes: the lane vectors of the points, re then im
+    float * b;                       // Same, the ping-pong partner of a
+} FftBatch;
+
+// Arena bytes fft_batch_init() needs for a plan of n
+size_t fft_batch_arena_size(size_t n);
+
+// Returns false if the arena is too small. The batch may use the plan's buffer: one batch of a plan per thread
+bool fft_batch_init(FftBatch * batch, Arena * arena, const FftPlan * plan);
+
+// count frames of n real samples (frame f at in + f * n, already windowed) into count spectra of n bins (out + f * n)
+void fft_batch_real(const FftBatch * batch, const float * in, size_t count, float complex * out);
+
+#endif // FFT_H_
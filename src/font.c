@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+#include "logger.h"
+
+// Font from the atlas linked into the binary. Glyphs and recs are malloc'd like raylib does, so UnloadFont() frees
+// it the same way as a loaded one
+static Font font_from_atlas(void)
+{
+    const int pixels = font_atlas_width * font_atlas_height;
+    unsigned char * data = malloc(pixels * 2);
+    GlyphInfo * glyphs = calloc(FONT_GLYPHS, sizeof(GlyphInfo));
+    Rectangle * recs = malloc(FONT_GLYPHS * sizeof(Rectangle));
+    if (data == NULL || glyphs == NULL || recs == NULL) {
+        free(data);
+        free(glyphs);
+        free(recs);
+        return (Font) { 0 };
+    }
+
+    // White glyphs with the baked coverage as alpha, the format GenImageFontAtlas produces
+    for (int i = 0; i < pixels; i++) {
+        data[2 * i] = 0xFF;
+        data[2 * i + 1] = font_atlas_alpha[i];
+    }
+    Image atlas = {
+        .data = data,
+        .width = font_atlas_width,
+        .height = font_atlas_height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+    };
+
+    for (int i = 0; i < FONT_GLYPHS; i++) {
+        const FontAtlasGlyph * g = &font_atlas_glyphs[i];
+        glyphs[i] = (GlyphInfo) { g->value, g->offset_x, g->offset_y, g->advance_x, { 0 } };
+        recs[i] = (Rectangle) { g->x, g->y, g->width, g->height };
+    }
+
+    Font font = {
+        .baseSize = FONT_SIZE,
+        .glyphCount = FONT_GLYPHS,
+        .glyphPadding = FONT_PADDING,
+        .texture = LoadTextureFromImage(atlas),
+        .recs = recs,
+        .glyphs = glyphs,
+    };
+    UnloadImage(atlas);
+    return font;
+}
+
+Font font_load(void)
+{
+    const char * path = getenv(FONT_OVERRIDE_ENV);
+    if (path != NULL && strcmp(path, "") != 0) {
+        Font font = LoadFontEx(path, FONT_SIZE, 0, FONT_GLYPHS);
+        if (IsFontReady(font)) {
+            log_info("font: %s", path);
+            return font;
+        }
+        log_warn("Could not load the font at $%s (%s), using the embedded one", FONT_OVERRIDE_ENV, path);
+    }
+    return font_from_atlas();
+}
@@ -0,0 +1,33 @@
+#ifndef FONT_H_
+#define FONT_H_
+
+#include <raylib.h>
+
+#define FONT_SIZE 30                          // Pixel size the glyphs are rasterized at
+#define FONT_GLYPHS 250                       // Codepoints 32 onwards, the set LoadFontEx(path, size, 0, 250) loads
+#define FONT_PADDING 4                        // Atlas padding around each glyph (raylib's TTF default)
+#define FONT_OVERRIDE_ENV "MUSIALIZER_FONT"   // TTF rasterized at startup instead of the embedded atlas
+
+// One glyph of the baked atlas: raylib's GlyphInfo metrics plus its rectangle in the atlas
+typedef struct {
+    int value;                                // Codepoint
+    short offset_x;
+    short offset_y;
+    short advance_x;
+    unsigned short x;                         // Atlas rectangle
+    unsigned short y;
+    unsigned short width;
+    unsigned short height;
+} FontAtlasGlyph;
+
+// Generated by the font baker (extra/font-bake.c) into bin/font_atlas.c at build time
+extern const int font_atlas_width;
+extern const int font_atlas_height;
+extern const unsigned char font_atlas_alpha[]; // width * height glyph coverage
+extern const FontAtlasGlyph font_atlas_glyphs[FONT_GLYPHS];
+
+// The UI font: the embedded atlas uploaded as is (no TTF parsing or rasterizing at startup, works from any working
+// directory), or the TTF at $MUSIALIZER_FONT when set. Needs the window (GL context) to be up
+Font font_load(void);
+
+#endif // FONT_H_
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysis.h"
+#include "arena.h"
+#include "capture.h"
+#include "clock.h"
+#include "export.h"
+#include "headless.h"
+#include "logger.h"
+#include "mel.h"
+#include "normalize.h"
+#include "onset.h"
+
+int headless_run(PcmInput * in, const char * out_path, const char * publish_name, const char * mel_path)
+{
+    const unsigned int sample_rate = in->config.sample_rate;
+    const size_t capacity = capture_arena_size(HEADLESS_N)                                  // capture ring
+                          + ARENA_ALIGN(HEADLESS_N * sizeof(float))                         // frame
+                          + analysis_arena_size(HEADLESS_N, ANALYSIS_LOWF, ANALYSIS_STEP)   // in, out, tables, bands
+                          + onset_arena_size(HEADLESS_N / 2)                                // previous magnitudes
+                          + mel_arena_size(HEADLESS_N, MEL_FILTERS, MEL_COEFFS);            // filterbank, DCT
+
+    Arena arena = { 0 };
+    Capture capture;
+    Analysis analysis;
+    Onset * onset = malloc(sizeof(Onset)); // Holds the onset history
+    Mel mel;
+    Exporter ex;
+    float * frame = NULL;
+    if (onset == NULL || ! arena_reserve(&arena, capacity) || ! capture_init(&capture, &arena, HEADLESS_N) ||
+        (frame = arena_alloc(&arena, HEADLESS_N * sizeof(float))) == NULL ||
+        ! analysis_init(&analysis, &arena, HEADLESS_N, ANALYSIS_LOWF, ANALYSIS_STEP) ||
+        ! onset_init(onset, &arena, HEADLESS_N / 2) ||
+        ! mel_init(&mel, &arena, HEADLESS_N, sample_rate, MEL_FILTERS, MEL_COEFFS) ||
+        ! export_open(&ex, out_path, sample_rate, HEADLESS_N, HEADLESS_HOP, analysis.m)) {
+        arena_free(&arena);
+        free(onset);
+        return 1;
+    }
+
+    Publisher pub = { .fd = -1 };
+    MelExporter mel_ex = { 0 };
+    Normalizer norm;
+    norm_init(&norm, -60.0f, 0.0f);
+    if ((publish_name != NULL && ! publish_open(&pub, publish_name, (uint32_t) analysis.m)) ||
+        (mel_path != NULL && ! export_mel_open(&mel_ex, mel_path, sample_rate, HEADLESS_N, HEADLESS_HOP,
+                                               MEL_FILTERS, MEL_COEFFS, mel.low_hz, mel.high_hz)) ||
+        ! pcm_start(in, &capture, NULL)) {
+        publish_close(&pub);
+        export_mel_close(&mel_ex);
+        export_close(&ex);
+        arena_free(&arena);
+        free(onset);
+        return 1;
+    }
+
+    // Windows [end - N, end) on the hop grid, each one as soon as the reader has pushed its last frame
+    const double start = clock_seconds();
+    const float hop_seconds = (float) HEADLESS_HOP / sample_rate;
+    bool ok = true;
+    size_t end = HEADLESS_N;
+    for (; ok && pcm_wait(in, end) >= end; end += HEADLESS_HOP) {
+        double energy = 0.0;
+        if (! capture_window(&capture, end, HEADLESS_N, frame, &energy)) {
+            log_error("headless: window at %zu was overwritten", end); // The reader must wait for pcm_release()
+            ok = false;
+            break;
+        }
+        analysis_frame_gated(&analysis, frame, energy);
+        onset_process(onset, analysis.power, end == HEADLESS_N ? 0.0f : hop_seconds);
+
+        const ExportBeat beat = { onset->strength, onset->beat_phase, onset->bpm };
+        ok = export_frame(&ex, analysis.bands, &beat);
+        if (ok && mel_ex.file != NULL) {
+            mel_process(&mel, analysis.power);
+            ok = export_mel_frame(&mel_ex, mel.log_mel, mel.mfcc);
+        }
+
+        if (pub.header != NULL) {
+            norm_update(&norm, analysis.frame_peak, hop_seconds);
+            publish_frame(&pub, analysis.bands, analysis.m, &norm, end, sample_rate, onset);
+        }
+
+        pcm_release(in, end + HEADLESS_HOP - HEADLESS_N); // Start of the next window
+    }
+    const double wall = clock_seconds() - start;
+
+    pcm_stop(in);
+    const double seconds = (double) capture_end(&capture) / sample_rate;
+    log_info("headless: %.1f s of audio in %.2f s (%.0fx real time), %zu frames, %zu gated as silence, %.1f BPM",
+             seconds, wall, wall > 0 ? seconds / wall : 0.0, analysis.frames, analysis.gated, onset->bpm);
+
+    publish_close(&pub);
+    if (! export_mel_close(&mel_ex)) ok = false;
+    if (! export_close(&ex)) ok = false;
+    if (! ok) {
+        log_error("Could not write: %s%s%s", out_path, mel_path != NULL ? " or " : "",
+                  mel_path != NULL ? mel_path : "");
+    }
+    arena_free(&arena);
+    free(onset);
+    return ok ? 0 : 1;
+}
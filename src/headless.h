@@ -0,0 +1,18 @@
+#ifndef HEADLESS_H_
+#define HEADLESS_H_
+
+#include "pcm.h"
+#include "publish.h"
+
+#define HEADLESS_N ((size_t) 2 << 9) // Same N as the visualizer
+#define HEADLESS_HOP (HEADLESS_N / 2) // 50% overlap, same records as --batch
+
+// Analysis of a raw PCM stream without a window: $ ffmpeg ... -f f32le - | musializer --headless <out|-> -
+// The reader thread fills the capture ring while this thread analyzes every hop as soon as its window is complete
+// and writes the records (see export.h) to out_path ("-" is stdout, point the logs to stderr first). Runs until the
+// input ends, returns the process exit code. publish_name (or NULL) also hands every frame to local readers
+// through shared memory (see publish.h), with the bars of a fixed -60..0 dBFS window. mel_path (or NULL) gets the
+// log-mel energies and MFCCs of every frame as a second stream (see mel.h and ExportMelHeader)
+int headless_run(PcmInput * in, const char * out_path, const char * publish_name, const char * mel_path);
+
+#endif // HEADLESS_H_
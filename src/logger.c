@@ -3,42 +3,54 @@
 
 #include "logger.h"
 
+static FILE * log_output = NULL; // stdout unless log_set_output() moved it
+
+static FILE * output(void)
+{
+    return log_output != NULL ? log_output : stdout;
+}
+
+void log_set_output(FILE * file)
+{
+    log_output = file;
+}
+
 void log_info(const char *format, ...)
 {
-    printf("[INFO] ");
+    fprintf(output(), "[INFO] ");
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(output(), format, args);
     va_end(args);
-    printf("\n");
+    fprintf(output(), "\n");
 }
 
 void log_warn(const char *format, ...)
 {
-    printf("[WARN] ");
+    fprintf(output(), "[WARN] ");
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(output(), format, args);
     va_end(args);
-    printf("\n");
+    fprintf(output(), "\n");
 }
 
 void log_error(const char *format, ...)
 {
-    printf("[ERROR] ");
+    fprintf(output(), "[ERROR] ");
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(output(), format, args);
     va_end(args);
-    printf("\n");
+    fprintf(output(), "\n");
 }
 
 void log_debug(const char * format, ...)
 {
-    printf("[DEBUG] ");
+    fprintf(output(), "[DEBUG] ");
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(output(), format, args);
     va_end(args);
-    printf("\n");
+    fprintf(output(), "\n");
 }
@@ -1,6 +1,11 @@
 #ifndef LOGGER_H_
 #define LOGGER_H_
 
+#include <stdio.h>
+
+// Where the log lines go (stdout by default, stderr when stdout carries data)
+void log_set_output(FILE * file);
+
 void log_info(const char *format, ...);
 void log_warn(const char *format, ...);
 void log_error(const char *format, ...);
@@ -1,32 +1,159 @@
+#define _DEFAULT_SOURCE // clock_gettime
+
 #include <raylib.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "app.h"
+#include "batch.h"
+#include "headless.h"
+#include "logger.h"
+#include "pcm.h"
+#include "render.h"
+#include "spectrum.h"
 
 // Handy length function
 #define ARRAY_LEN(xs) sizeof(xs) / sizeof(xs[0])
 
+// Milliseconds since the first call (process start when called first thing in main)
+static double elapsed_ms(void)
+{
+    static struct timespec start = { 0 };
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (start.tv_sec == 0 && start.tv_nsec == 0) start = now;
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void usage(const char * program)
+{
+    log_error("Usage: %s [<file> | - | --pcm <fifo>] [--rate <hz>] [--channels <n>] [--format f32le|s16le|s32le|u8] "
+              "[--headless <out|->] [--mfcc <out|->] [--publish <shm name>]", program);
+    log_error("       %s --batch <out_dir> <dir|file>...", program);
+    log_error("       %s --spectrogram <out.png> <file>", program);
+    log_error("       %s --spectrum <N> <out|-> <file>", program);
+}
+
 int main(int argc, char **argv)
 {
-    (void) argc;
+    elapsed_ms(); // Cold start clock
+    // Offline modes (no window) ---------------------------------------------------------------------
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        if (argc < 4) {
+            log_error("Usage: %s --batch <out_dir> <dir|file>...", argv[0]);
+            return 1;
+        }
+        return batch_run(argv[2], argc - 3, argv + 3);
+    }
+    if (argc > 1 && strcmp(argv[1], "--spectrogram") == 0) {
+        if (argc != 4) {
+            log_error("Usage: %s --spectrogram <out.png> <file>", argv[0]);
+            return 1;
+        }
+        return render_spectrogram(argv[2], argv[3]);
+    }
+    if (argc > 1 && strcmp(argv[1], "--spectrum") == 0) {
+        if (argc != 5) {
+            log_error("Usage: %s --spectrum <N> <out|-> <file>", argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[3], "-") == 0) log_set_output(stderr); // stdout carries the spectrum
+        return spectrum_run(argv[3], argv[4], (size_t) strtoull(argv[2], NULL, 10));
+    }
+
+    // Arguments: a music file, or raw PCM from stdin ("-") or a named pipe with its layout
+    const char * file_path = NULL;
+    const char * pcm_path = NULL;
+    const char * headless_out = NULL;
+    const char * publish_name = NULL;
+    const char * mel_out = NULL;
+    PcmConfig config = PCM_DEFAULT_CONFIG;
+    for (int i = 1; i < argc; i++) {
+        const char * arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "-") == 0) {
+            pcm_path = arg;
+        } else if (strcmp(arg, "--pcm") == 0 && has_value) {
+            pcm_path = argv[++i];
+        } else if (strcmp(arg, "--rate") == 0 && has_value) {
+            config.sample_rate = (unsigned int) atoi(argv[++i]);
+        } else if (strcmp(arg, "--channels") == 0 && has_value) {
+            config.channels = (unsigned int) atoi(argv[++i]);
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            if (! pcm_parse_format(argv[++i], &config.format)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--headless") == 0 && has_value) {
+            headless_out = argv[++i];
+        } else if (strcmp(arg, "--mfcc") == 0 && has_value) {
+            mel_out = argv[++i];
+        } else if (strcmp(arg, "--publish") == 0 && has_value) {
+            publish_name = argv[++i];
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            file_path = arg;
+        }
+    }
+
+    if (mel_out != NULL && headless_out == NULL) {
+        log_error("--mfcc is written by the headless mode: add --headless <out|->");
+        return 1;
+    }
+    if (mel_out != NULL && strcmp(mel_out, "-") == 0 && strcmp(headless_out, "-") == 0) {
+        log_error("--headless and --mfcc cannot both write to stdout");
+        return 1;
+    }
+    if ((headless_out != NULL && strcmp(headless_out, "-") == 0) || (mel_out != NULL && strcmp(mel_out, "-") == 0)) {
+        log_set_output(stderr); // stdout carries the records
+    }
+
+    PcmInput pcm;
+    if (pcm_path != NULL && ! pcm_open(&pcm, pcm_path, config)) return 1;
+    if (headless_out != NULL) {
+        if (pcm_path == NULL) {
+            log_error("--headless reads raw PCM: give - or --pcm <fifo>");
+            return 1;
+        }
+        const int code = headless_run(&pcm, headless_out, publish_name, mel_out);
+        pcm_close(&pcm);
+        return code;
+    }
 
     // Initialization ------------------------------------------------------------------------------
-    const char * file_path = argv[1];
-    AppState * state = app_init(file_path);
+    AppState * state = app_init(pcm_path != NULL ? NULL : file_path);
+    if (pcm_path != NULL) app_stream(state, &pcm); // The app closes it
+    if (publish_name != NULL) app_publish(state, publish_name);
 
     // Main game loop ------------------------------------------------------------------------------
+    bool first_frame = true;
     while (! WindowShouldClose()) {
         if (IsKeyPressed(KEY_Q)) break; // Quit/Close
 
         // Update ----------------------------------------------------------------------------------
         app_update(state);
 
+        // Nothing visible changed (or the window is minimized): no draw, just keep the loop paced
+        if (! app_should_draw(state)) {
+            app_wait(state);
+            continue;
+        }
+
         // Draw
         BeginDrawing(); //--------------------------------------------------------------------------
 
         app_draw(state);
 
         EndDrawing(); //----------------------------------------------------------------------------
+
+        if (first_frame) {
+            log_info("cold start: first frame %.1f ms after launch", elapsed_ms());
+            first_frame = false;
+        }
     }
 
     // De-Initialization ---------------------------------------------------------------------------
@@ -0,0 +1,114 @@
+#include <assert.h>
+#include <math.h>
+
+#include "analysis.h"
+#include "mel.h"
+
+// Every bin is inside at most two neighboring triangles, plus one nearest bin for a filter too narrow to hold any
+static size_t max_weights(size_t bins, size_t filters)
+{
+    return 2 * bins + filters;
+}
+
+static float hz_to_mel(float hz)
+{
+    return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float mel_to_hz(float mel)
+{
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+size_t mel_arena_size(size_t n, size_t filters, size_t coeffs)
+{
+    return 3 * ARENA_ALIGN(filters * sizeof(size_t))                      // first, count, offset
+         + ARENA_ALIGN(max_weights(n / 2, filters) * sizeof(float))      // weights
+         + ARENA_ALIGN(coeffs * filters * sizeof(float))                  // dct
+         + ARENA_ALIGN(filters * sizeof(float))                           // log_mel
+         + ARENA_ALIGN(coeffs * sizeof(float));                           // mfcc
+}
+
+bool mel_init(Mel * mel, Arena * arena, size_t n, unsigned int sample_rate, size_t filters, size_t coeffs)
+{
+    const double pi = 3.14159265358979323846;
+    assert(filters > 0 && coeffs <= filters);
+
+    const size_t bins = n / 2;
+    *mel = (Mel) { .bins = bins, .filters = filters, .coeffs = coeffs };
+    mel->first = (size_t *) arena_alloc(arena, filters * sizeof(size_t));
+    mel->count = (size_t *) arena_alloc(arena, filters * sizeof(size_t));
+    mel->offset = (size_t *) arena_alloc(arena, filters * sizeof(size_t));
+    mel->weights = (float *) arena_alloc(arena, max_weights(bins, filters) * sizeof(float));
+    mel->dct = (float *) arena_alloc(arena, coeffs * filters * sizeof(float));
+    mel->log_mel = (float *) arena_alloc(arena, filters * sizeof(float));
+    mel->mfcc = (float *) arena_alloc(arena, coeffs * sizeof(float));
+    if (mel->first == NULL || mel->count == NULL || mel->offset == NULL || mel->weights == NULL ||
+        mel->dct == NULL || mel->log_mel == NULL || mel->mfcc == NULL) {
+        return false;
+    }
+
+    // Edges and centers: filters + 2 points evenly spaced in mel, triangle f rises from point f to f + 1 and falls
+    // to f + 2. Bin q sits at q * rate / n Hz
+    const float nyquist = sample_rate / 2.0f;
+    mel->low_hz = MEL_LOW_HZ;
+    mel->high_hz = MEL_HIGH_HZ < nyquist ? MEL_HIGH_HZ : nyquist;
+    const float low = hz_to_mel(mel->low_hz);
+    const float high = hz_to_mel(mel->high_hz);
+    const float bin_hz = (float) sample_rate / n;
+    size_t used = 0;
+    for (size_t f = 0; f < filters; f++) {
+        const float left = mel_to_hz(low + (high - low) * f / (filters + 1));
+        const float center = mel_to_hz(low + (high - low) * (f + 1) / (filters + 1));
+        const float right = mel_to_hz(low + (high - low) * (f + 2) / (filters + 1));
+
+        mel->offset[f] = used;
+        mel->first[f] = bins;
+        for (size_t q = (size_t) (left / bin_hz); q < bins && q * bin_hz < right; q++) {
+            const float hz = q * bin_hz;
+            if (hz <= left) continue;
+            if (mel->first[f] == bins) mel->first[f] = q;
+            mel->weights[used++] = hz <= center ? (hz - left) / (center - left) : (right - hz) / (right - center);
+        }
+        if (mel->first[f] == bins) {
+            // Narrower than a bin (low filters of a small N): the bin nearest to the center stands in
+            size_t q = (size_t) (center / bin_hz + 0.5f);
+            mel->first[f] = q < bins ? q : bins - 1;
+            mel->weights[used++] = 1.0f;
+        }
+        mel->count[f] = used - mel->offset[f];
+    }
+
+    for (size_t k = 0; k < coeffs; k++) {
+        const double scale = sqrt((k == 0 ? 1.0 : 2.0) / filters);
+        for (size_t f = 0; f < filters; f++) {
+            mel->dct[k * filters + f] = (float) (scale * cos(pi * k * (f + 0.5) / filters));
+        }
+    }
+
+    mel->full_scale_db = 10.0f * log10f((float) n * n / 16.0f);
+    for (size_t f = 0; f < filters; f++) mel->log_mel[f] = MEL_FLOOR_DB;
+    for (size_t k = 0; k < coeffs; k++) mel->mfcc[k] = 0.0f;
+    return true;
+}
+
+void mel_process(Mel * mel, const float * power)
+{
+    // Filters are stored in order, weights and power are both read front to back
+    for (size_t f = 0; f < mel->filters; f++) {
+        const float * w = mel->weights + mel->offset[f];
+        const float * p = power + mel->first[f];
+        float energy = 0.0f;
+        for (size_t i = 0; i < mel->count[f]; i++) energy += w[i] * p[i];
+
+        const float db = energy > 0.0f ? analysis_db(energy) - mel->full_scale_db : MEL_FLOOR_DB;
+        mel->log_mel[f] = db > MEL_FLOOR_DB ? db : MEL_FLOOR_DB;
+    }
+
+    for (size_t k = 0; k < mel->coeffs; k++) {
+        const float * row = mel->dct + k * mel->filters;
+        float sum = 0.0f;
+        for (size_t f = 0; f < mel->filters; f++) sum += row[f] * mel->log_mel[f];
+        mel->mfcc[k] = sum;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef MEL_H_
+#define MEL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+#define MEL_FILTERS 40             // Triangular filters
+#define MEL_COEFFS 13              // Cepstral coefficients kept (c0 included)
+#define MEL_LOW_HZ 0.0f            // Lower edge of the first filter
+#define MEL_HIGH_HZ 8000.0f        // Upper edge of the last filter (Nyquist when lower)
+#define MEL_FLOOR_DB -120.0f       // Log-mel of an empty filter, same floor as the gated bands
+
+// Mel features of the analysis frames: a filterbank of triangles evenly spaced on the mel scale
+// (2595 * log10(1 + f / 700)), the log of each filter energy and its DCT (the MFCCs). A triangle only covers the bins
+// between its neighbors' centers, so the weights are stored sparse: filter f is weights[offset[f] ..] over the
+// contiguous bins [first[f], first[f] + count[f]). Applying the bank is one forward pass over both arrays, about two
+// multiply-adds per bin whatever the number of filters
+typedef struct {
+    size_t bins;                   // Bins per frame (N/2)
+    size_t filters;
+    size_t coeffs;
+    float low_hz;                  // Edges of the bank, high_hz capped at Nyquist
+    float high_hz;
+    size_t * first;                // First bin of each filter (filters)
+    size_t * count;                // Bins of each filter, at least 1
+    size_t * offset;               // Start of each filter in weights
+    float * weights;               // Every filter back to back, peak 1 at the center
+    float * dct;                   // coeffs x filters, orthonormal DCT-II
+    float full_scale_db;           // Power of a full scale sine through the Hann window, 0 dB
+
+    // Published after each mel_process() ------------------------------------------------------------
+    float * log_mel;               // Filter energies in dBFS (filters)
+    float * mfcc;                  // DCT of log_mel (coeffs)
+} Mel;
+
+// Arena bytes mel_init() needs
+size_t mel_arena_size(size_t n, size_t filters, size_t coeffs);
+
+// Filters for an FFT of n at sample_rate, coeffs <= filters. Returns false if the arena is too small
+bool mel_init(Mel * mel, Arena * arena, size_t n, unsigned int sample_rate, size_t filters, size_t coeffs);
+
+// Feed the squared magnitudes of one frame (Analysis.power)
+void mel_process(Mel * mel, const float * power);
+
+#endif // MEL_H_
@@ -0,0 +1,169 @@
+#include <math.h>
+#include <string.h>
+
+#include "meter.h"
+
+#define METER_FLOOR_DB -120.0f
+
+static const double PI_D = 3.14159265358979323846;
+
+static float to_db(double power)
+{
+    if (power <= 1e-12) return METER_FLOOR_DB;
+    return (float) (10.0 * log10(power));
+}
+
+// K-weighting from ITU-R BS.1770, coefficients derived for any sample rate (same analog prototypes as libebur128)
+static void kweight_init(Biquad filters[2], unsigned int sample_rate)
+{
+    // Stage 1: high shelf (+4 dB above ~1.7 kHz, head effects)
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(PI_D * f0 / sample_rate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    filters[0] = (Biquad) {
+        .b0 = (float) ((vh + vb * k / q + k * k) / a0),
+        .b1 = (float) (2.0 * (k * k - vh) / a0),
+        .b2 = (float) ((vh - vb * k / q + k * k) / a0),
+        .a1 = (float) (2.0 * (k * k - 1.0) / a0),
+        .a2 = (float) ((1.0 - k / q + k * k) / a0),
+    };
+
+    // Stage 2: RLB high pass (~38 Hz)
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(PI_D * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    filters[1] = (Biquad) {
+        .b0 = 1.0f, .b1 = -2.0f, .b2 = 1.0f,
+        .a1 = (float) (2.0 * (k * k - 1.0) / a0),
+        .a2 = (float) ((1.0 - k / q + k * k) / a0),
+    };
+}
+
+static float biquad(Biquad * f, float x)
+{
+    const float y = f->b0 * x + f->z1;
+    f->z1 = f->b1 * x - f->a1 * y + f->z2;
+    f->z2 = f->b2 * x - f->a2 * y;
+    return y;
+}
+
+// Windowed sinc low pass at the original Nyquist, split into METER_TP_PHASES interpolation phases
+static void true_peak_init(float coeffs[METER_TP_PHASES][METER_TP_TAPS])
+{
+    const size_t taps = METER_TP_PHASES * METER_TP_TAPS;
+    const double center = (taps - 1) / 2.0;
+    for (size_t i = 0; i < taps; i++) {
+        const double x = (i - center) / METER_TP_PHASES;
+        const double sinc = x == 0.0 ? 1.0 : sin(PI_D * x) / (PI_D * x);
+        const double hann = 0.5 - 0.5 * cos(2.0 * PI_D * (i + 0.5) / taps);
+        coeffs[i % METER_TP_PHASES][i / METER_TP_PHASES] = (float) (sinc * hann);
+    }
+}
+
+void meter_init(Meter * meter, unsigned int sample_rate)
+{
+    memset(meter, 0, sizeof(*meter));
+
+    meter->rms_alpha = 1.0f - expf(-1.0f / (0.3f * sample_rate)); // 300 ms
+    meter->peak_fall = powf(10.0f, -20.0f / 20.0f / sample_rate);  // Falls back 20 dB per second
+
+    true_peak_init(meter->tp_coeffs);
+    for (size_t c = 0; c < METER_CHANNELS; c++) kweight_init(meter->kweight[c], sample_rate);
+
+    meter->block_len = sample_rate / 10; // 100 ms
+    if (meter->block_len == 0) meter->block_len = 1;
+
+    for (size_t c = 0; c < METER_CHANNELS; c++) {
+        meter->pub.levels.rms_db[c] = METER_FLOOR_DB;
+        meter->pub.levels.peak_db[c] = METER_FLOOR_DB;
+    }
+    meter->pub.levels.loudness = METER_FLOOR_DB;
+}
+
+static void publish(Meter * meter)
+{
+    MeterLevels levels;
+    for (size_t c = 0; c < METER_CHANNELS; c++) {
+        levels.rms_db[c] = to_db(meter->ms[c]);
+        levels.peak_db[c] = to_db((double) meter->peak[c] * meter->peak[c]);
+    }
+
+    levels.loudness = METER_FLOOR_DB;
+    if (meter->blocks_filled > 0) {
+        const double mean_square = meter->window_sum / (double) (meter->blocks_filled * meter->block_len);
+        if (mean_square > 1e-12) levels.loudness = (float) (-0.691 + 10.0 * log10(mean_square));
+    }
+
+    // Sequence lock, single writer: odd while writing, readers retry if it moved
+    const unsigned int seq = meter->pub.seq;
+    __atomic_store_n(&meter->pub.seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    meter->pub.levels = levels;
+    __atomic_store_n(&meter->pub.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void meter_process(Meter * meter, const float * frames, size_t framesc)
+{
+    for (size_t i = 0; i < framesc; i++) {
+        double weighted = 0.0;
+        const size_t pos = meter->tp_pos;
+
+        for (size_t c = 0; c < METER_CHANNELS; c++) {
+            const float x = frames[i * METER_CHANNELS + c];
+
+            // RMS
+            meter->ms[c] += meter->rms_alpha * (x * x - meter->ms[c]);
+
+            // True peak: newest sample first, the doubled history keeps the taps contiguous
+            float * history = meter->tp_history[c];
+            history[pos] = x;
+            history[pos + METER_TP_TAPS] = x;
+            const float * taps = history + pos + 1; // taps[METER_TP_TAPS - 1] is x
+            float peak = meter->peak[c] * meter->peak_fall;
+            for (size_t p = 0; p < METER_TP_PHASES; p++) {
+                float y = 0.0f;
+                for (size_t j = 0; j < METER_TP_TAPS; j++) y += meter->tp_coeffs[p][j] * taps[METER_TP_TAPS - 1 - j];
+                y = fabsf(y);
+                if (y > peak) peak = y;
+            }
+            meter->peak[c] = peak;
+
+            // K-weighted energy
+            const float k = biquad(&meter->kweight[c][1], biquad(&meter->kweight[c][0], x));
+            weighted += (double) k * k;
+        }
+        meter->tp_pos = (pos + 1) % METER_TP_TAPS;
+
+        // Short-term loudness: finished blocks slide through a running window sum
+        meter->block_sum += weighted;
+        if (++meter->block_fill == meter->block_len) {
+            meter->window_sum += meter->block_sum - meter->blocks[meter->block_pos];
+            if (meter->window_sum < 0.0) meter->window_sum = 0.0; // Rounding drift
+            meter->blocks[meter->block_pos] = meter->block_sum;
+            meter->block_pos = (meter->block_pos + 1) % METER_BLOCKS;
+            if (meter->blocks_filled < METER_BLOCKS) meter->blocks_filled++;
+            meter->block_sum = 0.0;
+            meter->block_fill = 0;
+        }
+    }
+
+    publish(meter);
+}
+
+MeterLevels meter_read(const Meter * meter)
+{
+    MeterLevels levels;
+    unsigned int before, after;
+    do {
+        before = __atomic_load_n(&meter->pub.seq, __ATOMIC_ACQUIRE);
+        levels = meter->pub.levels;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&meter->pub.seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+    return levels;
+}
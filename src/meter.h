@@ -0,0 +1,62 @@
+#ifndef METER_H_
+#define METER_H_
+
+#include <stddef.h>
+
+#define METER_CHANNELS 2     // Raylib hands stereo frames to the stream processors
+#define METER_BLOCKS 30      // Short-term loudness window: 30 blocks of 100 ms = 3 s
+#define METER_TP_PHASES 4    // True peak oversampling factor
+#define METER_TP_TAPS 12     // FIR taps per phase (48 taps total, same size as the BS.1770 filter)
+
+// Levels published to the render thread (dBFS, loudness in LUFS)
+typedef struct {
+    float rms_db[METER_CHANNELS];  // 300 ms RMS
+    float peak_db[METER_CHANNELS]; // 4x oversampled true peak with a slow fall back
+    float loudness;                // K-weighted short-term loudness (3 s)
+} MeterLevels;
+
+typedef struct {
+    float b0, b1, b2, a1, a2;      // Coefficients (a0 normalized to 1)
+    float z1, z2;                  // Transposed direct form II state
+} Biquad;
+
+// Level meter fed sample by sample from the audio callback: O(1) per sample and no allocations. The levels are
+// published through a sequence lock, the render thread reads them with meter_read() without ever blocking the
+// audio thread
+typedef struct {
+    // Audio thread --------------------------------------------------------------------------------------------------
+    float rms_alpha;                                       // One pole coefficient for the RMS
+    float peak_fall;                                       // Per sample multiplier of the peak hold
+    float ms[METER_CHANNELS];                              // Smoothed mean square
+    float peak[METER_CHANNELS];                            // Peak hold (linear)
+
+    float tp_coeffs[METER_TP_PHASES][METER_TP_TAPS];       // Polyphase interpolation filter
+    float tp_history[METER_CHANNELS][METER_TP_TAPS * 2];   // Last taps, stored twice so reads never wrap
+    size_t tp_pos;
+
+    Biquad kweight[METER_CHANNELS][2];                     // Pre-filter (high shelf) + RLB high pass
+    size_t block_len;                                      // Samples per 100 ms block
+    size_t block_fill;                                     // Samples in the current block
+    double block_sum;                                      // K-weighted sum of squares of the current block
+    double blocks[METER_BLOCKS];                           // Last finished blocks
+    size_t block_pos;
+    size_t blocks_filled;                                  // Up to METER_BLOCKS, so the first 3 s are not diluted
+    double window_sum;                                     // Sum of blocks[], kept up to date incrementally
+
+    // Shared with the render thread (own cache line) ----------------------------------------------------------------
+    struct {
+        unsigned int seq;                                  // Odd while the audio thread is writing
+        MeterLevels levels;
+    } __attribute__((aligned(64))) pub;
+} Meter;
+
+// Reset all state and compute the filters for this sample rate (call while the audio callback is detached)
+void meter_init(Meter * meter, unsigned int sample_rate);
+
+// Feed interleaved stereo frames (audio thread)
+void meter_process(Meter * meter, const float * frames, size_t framesc);
+
+// Consistent snapshot of the last published levels (render thread, lock free)
+MeterLevels meter_read(const Meter * meter);
+
+#endif // METER_H_
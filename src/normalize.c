@@ -0,0 +1,41 @@
+#include <math.h>
+
+#include "normalize.h"
+
+void norm_init(Normalizer * norm, float floor_db, float ceil_db)
+{
+    norm->floor_db = floor_db;
+    norm->ceil_db = ceil_db;
+    norm->agc = false;
+    norm->attack = 0.1f;
+    norm->release = 3.0f;
+    norm_reset(norm);
+}
+
+float norm_apply(const Normalizer * norm, float db)
+{
+    const float range = norm->ceil_db - norm->floor_db;
+    const float ceil = norm->agc ? norm->peak_db : norm->ceil_db;
+
+    const float t = (db - (ceil - range)) / range;
+    if (! (t > 0.0f)) return 0.0f; // Also catches NaN from log(0) on the libm path
+    if (t > 1.0f) return 1.0f;
+    return t;
+}
+
+void norm_update(Normalizer * norm, float frame_peak_db, float dt)
+{
+    // Clamp so silence (-inf) and clipping cannot push the AGC outside its range
+    const float lowest = norm->ceil_db - NORM_MAX_GAIN_DB;
+    if (! (frame_peak_db > lowest)) frame_peak_db = lowest;
+    if (frame_peak_db > norm->ceil_db) frame_peak_db = norm->ceil_db;
+
+    const float tau = frame_peak_db > norm->peak_db ? norm->attack : norm->release;
+    const float alpha = 1.0f - expf(-dt / tau); // One pole smoothing, independent of the frame rate
+    norm->peak_db += alpha * (frame_peak_db - norm->peak_db);
+}
+
+void norm_reset(Normalizer * norm)
+{
+    norm->peak_db = norm->ceil_db;
+}
@@ -0,0 +1,31 @@
+#ifndef NORMALIZE_H_
+#define NORMALIZE_H_
+
+#include <stdbool.h>
+
+#define NORM_MAX_GAIN_DB 48.0f // How far the AGC can pull the window down for quiet material
+
+// Maps band levels in dBFS to bar heights in [0, 1] over a fixed [floor, ceiling] window. With the automatic gain on,
+// the window slides to follow a smoothed frame peak (fast attack, slow release) so transients no longer pump the
+// whole display the way the per frame max rescale did
+typedef struct {
+    float floor_db;      // Drawn empty at or below this
+    float ceil_db;       // Drawn full at or above this
+    bool agc;            // Slide the window with the automatic gain
+    float attack;        // AGC time constant (seconds) when the level rises
+    float release;       // AGC time constant (seconds) when the level falls
+    float peak_db;       // AGC state: smoothed frame peak (the current ceiling)
+} Normalizer;
+
+void norm_init(Normalizer * norm, float floor_db, float ceil_db);
+
+// Level in dBFS to bar height in [0, 1]
+float norm_apply(const Normalizer * norm, float db);
+
+// Feed the loudest band of the frame that was just drawn, dt is the time since the last frame in seconds
+void norm_update(Normalizer * norm, float frame_peak_db, float dt);
+
+// Forget the AGC history (new track)
+void norm_reset(Normalizer * norm);
+
+#endif // NORMALIZE_H_
@@ -0,0 +1,195 @@
+#include <math.h>
+#include <string.h>
+
+#include "fastmath.h"
+#include "onset.h"
+
+#define ONSET_GAMMA 100.0f         // Log compression of the magnitudes, log(1 + gamma * |X|)
+#define ONSET_THRESHOLD 1.5f       // A peak must be this many times the running mean
+#define ONSET_FLOOR 1e-4f          // and above this (silence never triggers)
+#define ONSET_MEAN_TIME 1.0f       // Seconds of the running mean
+#define ONSET_MIN_HISTORY 4.0f     // Seconds of history before the first tempo estimate
+#define ONSET_PRIOR_BPM 120.0f     // Center of the tempo prior, picks between half/double tempo candidates
+#define ONSET_PRIOR_OCTAVES 1.0f   // and its width
+#define ONSET_HARMONICS 4          // Peaks of the autocorrelation at k * lag used to refine the lag
+#define ONSET_BPM_TRACK 0.05f      // New estimates closer than this (relative) are smoothed into the old one
+
+size_t onset_arena_size(size_t bins)
+{
+    return ARENA_ALIGN(bins * sizeof(float)); // prev
+}
+
+bool onset_init(Onset * onset, Arena * arena, size_t bins)
+{
+    onset->bins = bins;
+    onset->prev = (float *) arena_alloc(arena, bins * sizeof(float));
+    if (onset->prev == NULL) return false;
+    onset_reset(onset);
+    return true;
+}
+
+void onset_reset(Onset * onset)
+{
+    memset(onset->prev, 0, onset->bins * sizeof(float));
+    memset(onset->history, 0, sizeof(onset->history));
+    onset->head = 0;
+    onset->count = 0;
+    onset->frame_dt = 0.0f;
+    onset->mean = 0.0f;
+    onset->since_tempo = 0.0f;
+
+    onset->strength = 0.0f;
+    onset->onset = false;
+    onset->bpm = 0.0f;
+    onset->confidence = 0.0f;
+    onset->beat_phase = 0.0f;
+}
+
+// Onset strength age frames ago (0 is the last one)
+static float history_at(const Onset * onset, size_t age)
+{
+    return onset->history[(onset->head + ONSET_HISTORY - 1 - age) % ONSET_HISTORY];
+}
+
+static float autocorrelation(const float * d, size_t count, size_t lag)
+{
+    float sum = 0.0f;
+    for (size_t i = lag; i < count; i++) sum += d[i] * d[i - lag];
+    return sum;
+}
+
+// Offset of the vertex of the parabola through (-1, a), (0, b), (1, c), 0 when b is not a maximum
+static float parabolic_peak(float a, float b, float c)
+{
+    const float den = a - 2.0f * b + c;
+    return den < 0.0f ? 0.5f * (a - c) / den : 0.0f;
+}
+
+// Autocorrelation of the onset strength over the tempo range, then a comb over the history at that period for
+// the phase. O(history * lags), only called every ONSET_TEMPO_PERIOD
+static void estimate_tempo(Onset * onset)
+{
+    const size_t count = onset->count;
+    const float dt = onset->frame_dt;
+
+    const float lag_min = 60.0f / (ONSET_MAX_BPM * dt);
+    const float lag_max = 60.0f / (ONSET_MIN_BPM * dt);
+    const size_t lo = lag_min < 2.0f ? 2 : (size_t) lag_min;
+    const size_t hi = (size_t) ceilf(lag_max);
+    if (2 * (hi + 1) >= count) return; // Not enough history for the slowest tempo yet
+
+    // Oldest first, mean removed
+    float d[ONSET_HISTORY];
+    float mean = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        d[i] = history_at(onset, count - 1 - i);
+        mean += d[i];
+    }
+    mean /= count;
+    for (size_t i = 0; i < count; i++) d[i] -= mean;
+
+    float acf[ONSET_HISTORY / 2];
+    for (size_t l = 0; l <= hi + 1; l++) acf[l] = autocorrelation(d, count, l);
+    if (acf[0] <= 0.0f) return; // Flat history (silence)
+
+    size_t best = 0;
+    float best_score = 0.0f;
+    for (size_t l = lo; l <= hi; l++) {
+        const float octaves = log2f(60.0f / (l * dt) / ONSET_PRIOR_BPM) / ONSET_PRIOR_OCTAVES;
+        const float score = acf[l] * expf(-0.5f * octaves * octaves);
+        if (score > best_score) {
+            best_score = score;
+            best = l;
+        }
+    }
+    if (best == 0) return; // No periodicity in range
+
+    // Sub frame lag: parabolic interpolation around the peak, then the same around its multiples (the peak at
+    // k * lag pins the lag down k times finer, which matters at low frame rates)
+    float lag = best + parabolic_peak(acf[best - 1], acf[best], acf[best + 1]);
+    float lag_sum = lag, k_sum = 1.0f;
+    for (size_t k = 2; k <= ONSET_HARMONICS; k++) {
+        size_t l = (size_t) (k * lag + 0.5f);
+        if (2 * (l + 2) >= count) break;
+        float a = autocorrelation(d, count, l - 1), b = autocorrelation(d, count, l);
+        float c = autocorrelation(d, count, l + 1);
+        // Hill climb one step in case rounding landed next to the peak
+        if (a > b && a > c) {
+            c = b, b = a, l--, a = autocorrelation(d, count, l - 1);
+        } else if (c > b) {
+            a = b, b = c, l++, c = autocorrelation(d, count, l + 1);
+        }
+        if (b <= 0.0f) break;
+        lag_sum += l + parabolic_peak(a, b, c);
+        k_sum += k;
+    }
+    lag = lag_sum / k_sum;
+
+    const float bpm = 60.0f / (lag * dt);
+    if (onset->bpm > 0.0f && fabsf(bpm - onset->bpm) < ONSET_BPM_TRACK * onset->bpm) {
+        onset->bpm += 0.3f * (bpm - onset->bpm);
+    } else {
+        onset->bpm = bpm;
+    }
+    onset->confidence = acf[best] / acf[0];
+
+    // Phase: the offset whose comb (every period, going back) collects the most onset strength is the last beat
+    const float period = 60.0f / (onset->bpm * dt);
+    size_t beat_age = 0;
+    float beat_score = -1.0f;
+    for (size_t phi = 0; phi < (size_t) period; phi++) {
+        float score = 0.0f;
+        for (float age = phi; age < count; age += period) score += history_at(onset, (size_t) (age + 0.5f));
+        if (score > beat_score) {
+            beat_score = score;
+            beat_age = phi;
+        }
+    }
+    onset->beat_phase = beat_age / period;
+}
+
+void onset_process(Onset * onset, const float * power, float dt)
+{
+    // Full scale sine through the Hann window has |X| = N/4 = bins/2
+    const float scale = 2.0f / onset->bins;
+    const bool fast = fast_math_enabled(FAST_LOG);
+
+    // Spectral flux: only rising energy counts, in the log domain so quiet and loud parts weigh alike
+    float flux = 0.0f;
+    for (size_t q = 0; q < onset->bins; q++) {
+        const float x = 1.0f + ONSET_GAMMA * scale * sqrtf(power[q]);
+        const float c = fast ? fast_logf(x) : logf(x);
+        const float rise = c - onset->prev[q];
+        if (rise > 0.0f) flux += rise;
+        onset->prev[q] = c;
+    }
+    flux /= onset->bins;
+
+    onset->history[onset->head] = flux;
+    onset->head = (onset->head + 1) % ONSET_HISTORY;
+    if (onset->count < ONSET_HISTORY) onset->count++;
+    onset->strength = flux;
+
+    if (dt <= 0.0f) return; // First frame or a jump: keep the history but do not trust the timing
+    onset->frame_dt = onset->frame_dt == 0.0f ? dt : onset->frame_dt + 0.05f * (dt - onset->frame_dt);
+
+    // Peak picking one frame late: the previous frame is an onset when it is a local max above the threshold
+    if (onset->count >= 3) {
+        const float h0 = history_at(onset, 0), h1 = history_at(onset, 1), h2 = history_at(onset, 2);
+        onset->onset = h1 > h0 && h1 >= h2 && h1 > ONSET_THRESHOLD * onset->mean && h1 > ONSET_FLOOR;
+    }
+    const float alpha = dt / ONSET_MEAN_TIME;
+    onset->mean += (alpha < 1.0f ? alpha : 1.0f) * (flux - onset->mean);
+
+    // The beat keeps running between tempo estimates
+    if (onset->bpm > 0.0f) {
+        onset->beat_phase += dt * onset->bpm / 60.0f;
+        onset->beat_phase -= floorf(onset->beat_phase);
+    }
+
+    onset->since_tempo += dt;
+    if (onset->since_tempo >= ONSET_TEMPO_PERIOD && onset->count * onset->frame_dt >= ONSET_MIN_HISTORY) {
+        onset->since_tempo = 0.0f;
+        estimate_tempo(onset);
+    }
+}
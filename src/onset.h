@@ -0,0 +1,47 @@
+#ifndef ONSET_H_
+#define ONSET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+#define ONSET_HISTORY 512          // Onset strength frames kept for the tempo estimator
+#define ONSET_MIN_BPM 60.0f        // Tempo search range
+#define ONSET_MAX_BPM 200.0f
+#define ONSET_TEMPO_PERIOD 1.0f    // Seconds between two tempo estimates
+
+// Onset detection from the spectral flux of the analysis frames, with a tempo and beat phase tracker on top.
+// Per frame cost is one pass over the bins; the tempo (autocorrelation of the onset history) runs once per
+// ONSET_TEMPO_PERIOD
+typedef struct {
+    size_t bins;                   // Bins per frame (N/2)
+    float * prev;                  // Log compressed magnitudes of the previous frame (bins, from the arena)
+
+    float history[ONSET_HISTORY];  // Ring of onset strength, one per frame
+    size_t head;                   // Next slot to write
+    size_t count;                  // Filled slots
+    float frame_dt;                // Average seconds between frames (the frames do not need a fixed hop)
+    float mean;                    // Running mean of the onset strength (adaptive threshold)
+    float since_tempo;             // Seconds since the last tempo estimate
+
+    // Published, read by the renderer and the exporters after each onset_process() -------------------
+    float strength;                // Onset strength (half wave rectified spectral flux) of the last frame
+    bool onset;                    // An onset peaked on the previous frame
+    float bpm;                     // Tempo estimate, 0 until there is enough history
+    float confidence;              // Normalized autocorrelation at the tempo lag [0, 1]
+    float beat_phase;              // Position inside the current beat [0, 1), 0 on the beat
+} Onset;
+
+// Arena bytes onset_init() needs
+size_t onset_arena_size(size_t bins);
+
+bool onset_init(Onset * onset, Arena * arena, size_t bins);
+
+// Feed the squared magnitudes of one frame (Analysis.power) that came dt seconds after the previous one
+void onset_process(Onset * onset, const float * power, float dt);
+
+// Forget the history (seek, new track)
+void onset_reset(Onset * onset);
+
+#endif // ONSET_H_
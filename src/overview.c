@@ -0,0 +1,497 @@
+#define _DEFAULT_SOURCE // sysconf, mkstemp, fdopen, fchmod
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fastmath.h"
+#include "fft.h"
+#include "logger.h"
+#include "overview.h"
+
+#define OVERVIEW_MAGIC 0x564F5A4D // "MZOV"
+#define OVERVIEW_VERSION 1
+#define OVERVIEW_MAX_WORKERS 64
+#define OVERVIEW_FLOOR_DB -80.0f  // Coarse spectrogram range [-80, 0] dBFS
+
+// One worker: a contiguous range of level 0 buckets and of spectrogram columns
+typedef struct {
+    Overview * ov;
+    const float * samples;        // Interleaved
+    unsigned int channels;
+    const size_t * edges;         // Spectrogram row bin edges (OVERVIEW_SPEC_ROWS + 1)
+    size_t begin_bucket, end_bucket;
+    size_t begin_col, end_col;
+} OverviewTask;
+
+static float mono(const float * samples, unsigned int channels, size_t frame)
+{
+    float sum = 0.0f;
+    for (unsigned int c = 0; c < channels; c++) sum += samples[frame * channels + c];
+    return sum / channels;
+}
+
+static void * overview_worker(void * arg)
+{
+    OverviewTask * task = arg;
+    Overview * ov = task->ov;
+
+    // Level 0 of the pyramid
+    for (size_t b = task->begin_bucket; b < task->end_bucket; b++) {
+        const size_t begin = b * OVERVIEW_BLOCK;
+        const size_t end = begin + OVERVIEW_BLOCK < ov->frames ? begin + OVERVIEW_BLOCK : ov->frames;
+        OverviewBucket bucket = { INFINITY, -INFINITY, 0.0f };
+        for (size_t i = begin; i < end; i++) {
+            const float x = mono(task->samples, task->channels, i);
+            if (x < bucket.min) bucket.min = x;
+            if (x > bucket.max) bucket.max = x;
+            bucket.ms += x * x;
+        }
+        bucket.ms /= (float) (end - begin);
+        ov->levels[0][b] = bucket;
+
+        for (size_t i = begin; i < end; i++) ov->pcm[i] = task->samples[i * task->channels];
+    }
+
+    // Coarse spectrogram, one FFT per column
+    const size_t N = OVERVIEW_SPEC_N;
+    float in[OVERVIEW_SPEC_N];
+    float window[OVERVIEW_SPEC_N];
+    float complex out[OVERVIEW_SPEC_N];
+    float complex tw[OVERVIEW_SPEC_N / 2];
+    fast_hann(window, N);
+    fast_twiddles(tw, N);
+    const float full_scale_db = 10.0f * log10f((float) N * N / 16.0f);
+
+    for (size_t col = task->begin_col; col < task->end_col; col++) {
+        if (__atomic_load_n(&ov->cancel, __ATOMIC_RELAXED)) return NULL;
+
+        const size_t center = (size_t) ((col + 0.5) * ov->frames / OVERVIEW_SPEC_COLS);
+        const size_t start = center > N / 2 ? center - N / 2 : 0;
+        for (size_t i = 0; i < N; i++) {
+            in[i] = start + i < ov->frames ? mono(task->samples, task->channels, start + i) * window[i] : 0.0f;
+        }
+        fft(in, 1, out, N, tw);
+
+        for (size_t row = 0; row < OVERVIEW_SPEC_ROWS; row++) {
+            float max_power = 0.0f;
+            for (size_t q = task->edges[row]; q < task->edges[row + 1]; q++) {
+                const float power = cmag2f(out[q]);
+                if (power > max_power) max_power = power;
+            }
+            const float db = fast_power_db(max_power) - full_scale_db;
+            float t = (db - OVERVIEW_FLOOR_DB) / -OVERVIEW_FLOOR_DB;
+            if (t < 0.0f) t = 0.0f;
+            if (t > 1.0f) t = 1.0f;
+            ov->spec[(OVERVIEW_SPEC_ROWS - 1 - row) * OVERVIEW_SPEC_COLS + col] = (unsigned char) (t * 255.0f);
+        }
+    }
+
+    return NULL;
+}
+
+// Allocate every level in one block, level k has ceil(len(k - 1) / 2) buckets down to a single one
+static bool alloc_levels(Overview * ov, size_t level0_len)
+{
+    size_t total = 0;
+    size_t len = level0_len;
+    ov->level_count = 0;
+    while (ov->level_count < OVERVIEW_MAX_LEVELS) {
+        ov->level_len[ov->level_count++] = len;
+        total += len;
+        if (len <= 1) break;
+        len = (len + 1) / 2;
+    }
+
+    ov->buckets = malloc(total * sizeof(OverviewBucket));
+    if (ov->buckets == NULL) return false;
+
+    OverviewBucket * ptr = ov->buckets;
+    for (size_t k = 0; k < ov->level_count; k++) {
+        ov->levels[k] = ptr;
+        ptr += ov->level_len[k];
+    }
+    return true;
+}
+
+static void build_upper_levels(Overview * ov)
+{
+    for (size_t k = 1; k < ov->level_count; k++) {
+        const OverviewBucket * below = ov->levels[k - 1];
+        const size_t below_len = ov->level_len[k - 1];
+        for (size_t b = 0; b < ov->level_len[k]; b++) {
+            OverviewBucket bucket = below[2 * b];
+            if (2 * b + 1 < below_len) {
+                const OverviewBucket other = below[2 * b + 1];
+                if (other.min < bucket.min) bucket.min = other.min;
+                if (other.max > bucket.max) bucket.max = other.max;
+                bucket.ms = (bucket.ms + other.ms) / 2;
+            }
+            ov->levels[k][b] = bucket;
+        }
+    }
+}
+
+static void cache_path(const Overview * ov, char * out, size_t size)
+{
+    snprintf(out, size, "%s.overview", ov->path);
+}
+
+static bool cache_read(Overview * ov)
+{
+    char path[sizeof(ov->path) + 16];
+    cache_path(ov, path, sizeof(path));
+    FILE * file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    bool ok = false;
+    uint32_t magic, version, path_len, level_count;
+    int64_t mtime;
+    uint64_t frames, level0_len;
+    char key[sizeof(ov->path)];
+
+    if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != OVERVIEW_MAGIC) goto done;
+    if (fread(&version, sizeof(version), 1, file) != 1 || version != OVERVIEW_VERSION) goto done;
+    if (fread(&mtime, sizeof(mtime), 1, file) != 1 || mtime != ov->mtime) goto done;
+    if (fread(&path_len, sizeof(path_len), 1, file) != 1 || path_len >= sizeof(key)) goto done;
+    if (fread(key, 1, path_len, file) != path_len) goto done;
+    key[path_len] = '\0';
+    if (strcmp(key, ov->path) != 0) goto done;
+    if (fread(&frames, sizeof(frames), 1, file) != 1) goto done;
+    if (fread(&level0_len, sizeof(level0_len), 1, file) != 1) goto done;
+    if (fread(&level_count, sizeof(level_count), 1, file) != 1) goto done;
+    if (frames == 0 || level0_len != (frames + OVERVIEW_BLOCK - 1) / OVERVIEW_BLOCK) goto done;
+
+    ov->frames = frames;
+    if (! alloc_levels(ov, level0_len) || ov->level_count != level_count) goto done;
+
+    const size_t total = ov->levels[ov->level_count - 1] + 1 - ov->buckets;
+    if (fread(ov->buckets, sizeof(OverviewBucket), total, file) != total) goto done;
+    if (fread(ov->spec, 1, sizeof(ov->spec), file) != sizeof(ov->spec)) goto done;
+    ok = true;
+
+done:
+    fclose(file);
+    if (! ok) {
+        free(ov->buckets);
+        ov->buckets = NULL;
+    }
+    return ok;
+}
+
+// Written to a temporary sibling and renamed over the cache, so a full disk or a second instance writing the same
+// track never leaves a torn file behind
+static void cache_write(const Overview * ov)
+{
+    char path[sizeof(ov->path) + 16], tmp[sizeof(ov->path) + 32];
+    cache_path(ov, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+
+    const int fd = mkstemp(tmp);
+    FILE * file = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (file == NULL) {
+        log_warn("Could not write the overview cache: %s", path);
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        return;
+    }
+    fchmod(fd, 0644); // mkstemp creates it owner only
+
+    const uint32_t magic = OVERVIEW_MAGIC;
+    const uint32_t version = OVERVIEW_VERSION;
+    const int64_t mtime = ov->mtime;
+    const uint32_t path_len = (uint32_t) strlen(ov->path);
+    const uint64_t frames = ov->frames;
+    const uint64_t level0_len = ov->level_len[0];
+    const uint32_t level_count = (uint32_t) ov->level_count;
+    const size_t total = ov->levels[ov->level_count - 1] + 1 - ov->buckets;
+
+    bool ok = fwrite(&magic, sizeof(magic), 1, file) == 1 &&
+              fwrite(&version, sizeof(version), 1, file) == 1 &&
+              fwrite(&mtime, sizeof(mtime), 1, file) == 1 &&
+              fwrite(&path_len, sizeof(path_len), 1, file) == 1 &&
+              fwrite(ov->path, 1, path_len, file) == path_len &&
+              fwrite(&frames, sizeof(frames), 1, file) == 1 &&
+              fwrite(&level0_len, sizeof(level0_len), 1, file) == 1 &&
+              fwrite(&level_count, sizeof(level_count), 1, file) == 1 &&
+              fwrite(ov->buckets, sizeof(OverviewBucket), total, file) == total &&
+              fwrite(ov->spec, 1, sizeof(ov->spec), file) == sizeof(ov->spec);
+    ok = fclose(file) == 0 && ok;
+    if (! ok || rename(tmp, path) != 0) {
+        log_warn("Could not write the overview cache: %s", path);
+        unlink(tmp);
+    }
+}
+
+static void * overview_job(void * arg)
+{
+    Overview * ov = arg;
+
+    if (cache_read(ov)) {
+        log_info("Overview loaded from cache: %s", ov->path);
+        __atomic_store_n(&ov->status, OVERVIEW_READY, __ATOMIC_RELEASE);
+        return NULL; // No decode until a seek needs the samples (overview_want_pcm())
+    }
+
+    // Raylib decodes the whole file in one call, the analysis below is what gets split across the cores
+    Wave wave = LoadWave(ov->path);
+    if (! IsWaveReady(wave)) {
+        __atomic_store_n(&ov->status, OVERVIEW_FAILED, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    float * samples = LoadWaveSamples(wave);
+    const unsigned int channels = wave.channels;
+    const size_t frames = wave.frameCount;
+    ov->sample_rate = wave.sampleRate;
+    UnloadWave(wave);
+
+    ov->pcm = malloc(frames * sizeof(float));
+    if (frames == 0 || samples == NULL || ov->pcm == NULL) {
+        UnloadWaveSamples(samples);
+        __atomic_store_n(&ov->status, OVERVIEW_FAILED, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    ov->frames = frames;
+
+    if (! alloc_levels(ov, (ov->frames + OVERVIEW_BLOCK - 1) / OVERVIEW_BLOCK)) {
+        UnloadWaveSamples(samples);
+        __atomic_store_n(&ov->status, OVERVIEW_FAILED, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    // Log spaced rows from bin 1 to N/2, at least one bin each
+    size_t edges[OVERVIEW_SPEC_ROWS + 1];
+    for (size_t row = 0; row <= OVERVIEW_SPEC_ROWS; row++) {
+        edges[row] = (size_t) powf(OVERVIEW_SPEC_N / 2, (float) row / OVERVIEW_SPEC_ROWS);
+        if (row > 0 && edges[row] <= edges[row - 1]) edges[row] = edges[row - 1] + 1;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    if (cores > OVERVIEW_MAX_WORKERS) cores = OVERVIEW_MAX_WORKERS;
+    const size_t workers = (size_t) cores;
+
+    pthread_t threads[OVERVIEW_MAX_WORKERS];
+    OverviewTask tasks[OVERVIEW_MAX_WORKERS];
+    const size_t buckets = ov->level_len[0];
+    for (size_t w = 0; w < workers; w++) {
+        tasks[w] = (OverviewTask) {
+            .ov = ov,
+            .samples = samples,
+            .channels = channels,
+            .edges = edges,
+            .begin_bucket = buckets * w / workers,
+            .end_bucket = buckets * (w + 1) / workers,
+            .begin_col = OVERVIEW_SPEC_COLS * w / workers,
+            .end_col = OVERVIEW_SPEC_COLS * (w + 1) / workers,
+        };
+    }
+    // The job thread takes the last chunk itself (and any chunk whose thread could not be started)
+    bool started[OVERVIEW_MAX_WORKERS] = { 0 };
+    for (size_t w = 0; w + 1 < workers; w++) {
+        started[w] = pthread_create(&threads[w], NULL, overview_worker, &tasks[w]) == 0;
+    }
+    overview_worker(&tasks[workers - 1]);
+    for (size_t w = 0; w + 1 < workers; w++) {
+        if (started[w]) {
+            pthread_join(threads[w], NULL);
+        } else {
+            overview_worker(&tasks[w]);
+        }
+    }
+
+    UnloadWaveSamples(samples);
+
+    if (__atomic_load_n(&ov->cancel, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&ov->status, OVERVIEW_FAILED, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    build_upper_levels(ov);
+    cache_write(ov);
+
+    log_info("Overview built with %zu workers: %s", workers, ov->path);
+    __atomic_store_n(&ov->pcm_ready, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ov->status, OVERVIEW_READY, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Left channel decode after a cache hit. Shared by the overview and a detached thread, the last one to let go frees
+// it: overview_free() only cancels and never waits for raylib to finish a decode it cannot interrupt
+typedef struct OverviewDecode {
+    char path[1024];
+    int refs;
+    int cancel;
+    int ready;                    // Written with release once pcm is complete
+    float * pcm;
+    size_t frames;
+    unsigned int sample_rate;
+} OverviewDecode;
+
+static void decode_release(OverviewDecode * decode)
+{
+    if (__atomic_sub_fetch(&decode->refs, 1, __ATOMIC_ACQ_REL) > 0) return;
+    free(decode->pcm);
+    free(decode);
+}
+
+static void * decode_job(void * arg)
+{
+    OverviewDecode * decode = arg;
+    Wave wave = LoadWave(decode->path);
+    float * samples = IsWaveReady(wave) && ! __atomic_load_n(&decode->cancel, __ATOMIC_RELAXED)
+                    ? LoadWaveSamples(wave) : NULL;
+    const size_t frames = wave.frameCount;
+    const unsigned int channels = wave.channels;
+    decode->sample_rate = wave.sampleRate;
+    UnloadWave(wave);
+
+    decode->pcm = samples != NULL ? malloc(frames * sizeof(float)) : NULL;
+    if (decode->pcm != NULL) {
+        for (size_t i = 0; i < frames; i++) decode->pcm[i] = samples[i * channels];
+        decode->frames = frames;
+        __atomic_store_n(&decode->ready, 1, __ATOMIC_RELEASE);
+    }
+    UnloadWaveSamples(samples);
+    decode_release(decode);
+    return NULL;
+}
+
+void overview_want_pcm(Overview * ov)
+{
+    // A fresh build publishes its own samples, READY without them means the result came from the cache
+    if (ov->decode != NULL || overview_status(ov) != OVERVIEW_READY ||
+        __atomic_load_n(&ov->pcm_ready, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    OverviewDecode * decode = calloc(1, sizeof(OverviewDecode));
+    if (decode == NULL) return;
+    memcpy(decode->path, ov->path, sizeof(decode->path));
+    decode->refs = 2;
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    const bool started = pthread_create(&thread, &attr, decode_job, decode) == 0;
+    pthread_attr_destroy(&attr);
+    if (! started) {
+        log_error("Could not start the decode for seeking: %s", ov->path);
+        free(decode);
+        return;
+    }
+    ov->decode = decode;
+}
+
+void overview_start(Overview * ov, const char * file_path)
+{
+    memset(ov, 0, sizeof(*ov));
+    strncpy(ov->path, file_path, sizeof(ov->path) - 1);
+    ov->mtime = GetFileModTime(file_path);
+    ov->status = OVERVIEW_RUNNING;
+
+    ov->thread_started = pthread_create(&ov->thread, NULL, overview_job, ov) == 0;
+    if (! ov->thread_started) {
+        log_error("Could not start the overview job");
+        ov->status = OVERVIEW_FAILED;
+    }
+}
+
+OverviewStatus overview_status(const Overview * ov)
+{
+    return (OverviewStatus) __atomic_load_n(&ov->status, __ATOMIC_ACQUIRE);
+}
+
+const float * overview_pcm(const Overview * ov, size_t * frames, unsigned int * sample_rate)
+{
+    if (__atomic_load_n(&ov->pcm_ready, __ATOMIC_ACQUIRE)) {
+        *frames = ov->frames;
+        *sample_rate = ov->sample_rate;
+        return ov->pcm;
+    }
+
+    // A decode that does not match the cached length is another version of the file, not usable for seeking
+    const OverviewDecode * decode = ov->decode;
+    if (decode == NULL || ! __atomic_load_n(&decode->ready, __ATOMIC_ACQUIRE) || decode->frames != ov->frames) {
+        return NULL;
+    }
+    *frames = decode->frames;
+    *sample_rate = decode->sample_rate;
+    return decode->pcm;
+}
+
+void overview_draw(Overview * ov, Rectangle dest, float from, float to)
+{
+    if (overview_status(ov) != OVERVIEW_READY || to <= from) return;
+
+    // Coarse spectrogram as the background
+    if (ov->spec_texture.id == 0) {
+        Image image = {
+            .data = ov->spec,
+            .width = OVERVIEW_SPEC_COLS,
+            .height = OVERVIEW_SPEC_ROWS,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE,
+        };
+        ov->spec_texture = LoadTextureFromImage(image);
+    }
+    const Rectangle src = { from * OVERVIEW_SPEC_COLS, 0, (to - from) * OVERVIEW_SPEC_COLS, OVERVIEW_SPEC_ROWS };
+    DrawTexturePro(ov->spec_texture, src, dest, (Vector2) { 0, 0 }, 0.0f, Fade(PURPLE, 0.6f));
+
+    // Deepest level where every pixel still covers at least one bucket
+    const int width = (int) dest.width;
+    if (width <= 0) return;
+    size_t level = 0;
+    while (level + 1 < ov->level_count && (to - from) * ov->level_len[level + 1] >= width) level++;
+
+    const OverviewBucket * buckets = ov->levels[level];
+    const size_t len = ov->level_len[level];
+    const double first = from * len;
+    const double per_pixel = (to - from) * len / width;
+    const float mid = dest.y + dest.height / 2;
+    const float half = dest.height / 2;
+
+    for (int x = 0; x < width; x++) {
+        size_t b0 = (size_t) (first + x * per_pixel);
+        size_t b1 = (size_t) (first + (x + 1) * per_pixel);
+        if (b0 >= len) break;
+        if (b1 <= b0) b1 = b0 + 1;
+        if (b1 > len) b1 = len;
+
+        OverviewBucket bucket = buckets[b0];
+        for (size_t b = b0 + 1; b < b1; b++) {
+            if (buckets[b].min < bucket.min) bucket.min = buckets[b].min;
+            if (buckets[b].max > bucket.max) bucket.max = buckets[b].max;
+            bucket.ms += buckets[b].ms;
+        }
+        const float rms = sqrtf(bucket.ms / (b1 - b0));
+
+        const float px = dest.x + x;
+        DrawLineV((Vector2) { px, mid - bucket.max * half }, (Vector2) { px, mid - bucket.min * half }, DARKGREEN);
+        DrawLineV((Vector2) { px, mid - rms * half }, (Vector2) { px, mid + rms * half }, GREEN);
+    }
+}
+
+void overview_free(Overview * ov)
+{
+    if (ov->thread_started) {
+        __atomic_store_n(&ov->cancel, 1, __ATOMIC_RELAXED);
+        pthread_join(ov->thread, NULL);
+    }
+    if (ov->decode != NULL) {
+        __atomic_store_n(&ov->decode->cancel, 1, __ATOMIC_RELAXED);
+        decode_release(ov->decode);
+    }
+    if (ov->spec_texture.id != 0) UnloadTexture(ov->spec_texture);
+    free(ov->buckets);
+    free(ov->pcm);
+    memset(ov, 0, sizeof(*ov));
+}
@@ -0,0 +1,78 @@
+#ifndef OVERVIEW_H_
+#define OVERVIEW_H_
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OVERVIEW_BLOCK 256        // Frames per level 0 bucket
+#define OVERVIEW_MAX_LEVELS 32    // Level k bucket covers OVERVIEW_BLOCK << k frames
+#define OVERVIEW_SPEC_N 1024      // FFT size of the coarse spectrogram
+#define OVERVIEW_SPEC_ROWS 64     // Log spaced frequency rows
+#define OVERVIEW_SPEC_COLS 512    // Columns over the whole track
+
+typedef struct {
+    float min;
+    float max;
+    float ms;                     // Mean square (RMS once square rooted, merges by averaging)
+} OverviewBucket;
+
+typedef enum {
+    OVERVIEW_NONE,                // No job started
+    OVERVIEW_RUNNING,             // Decoding / building in the background
+    OVERVIEW_READY,               // Pyramid and spectrogram can be drawn
+    OVERVIEW_FAILED,
+} OverviewStatus;
+
+// Whole track overview built once per track by a background job: a min/max/RMS pyramid (level k halves level k-1)
+// and a coarse spectrogram. Results are cached next to the track in "<track>.overview" keyed by path and mtime,
+// reopening the same file only reads the cache
+typedef struct {
+    // Job -----------------------------------------------------------------------------------------------------------
+    pthread_t thread;
+    bool thread_started;          // thread is joinable, false when pthread_create() failed
+    int status;                   // OverviewStatus, written by the job with release, read with acquire
+    int cancel;                   // Set by overview_free() to stop the workers early
+    char path[1024];
+    long mtime;
+
+    // Result (owned by the job until status is OVERVIEW_READY) -----------------------------------------------------
+    size_t frames;                // Track length in frames
+    OverviewBucket * buckets;     // Every level in one block
+    OverviewBucket * levels[OVERVIEW_MAX_LEVELS];
+    size_t level_len[OVERVIEW_MAX_LEVELS];
+    size_t level_count;
+    unsigned char spec[OVERVIEW_SPEC_ROWS * OVERVIEW_SPEC_COLS]; // Row major, row 0 = highest frequency
+
+    // Decoded left channel of the whole track, used to refill the analysis window after a seek. A fresh build gets
+    // it for free from its own decode. After a cache hit nothing is decoded until the first seek asks for it
+    // (overview_want_pcm()), then a detached decode fills decode
+    float * pcm;
+    unsigned int sample_rate;
+    int pcm_ready;                // Written with release once pcm is complete
+    struct OverviewDecode * decode;
+
+    // Render thread -------------------------------------------------------------------------------------------------
+    Texture2D spec_texture;       // Uploaded lazily on the first draw after the job is done
+} Overview;
+
+// Start building the overview of file_path in the background
+void overview_start(Overview * ov, const char * file_path);
+
+OverviewStatus overview_status(const Overview * ov);
+
+// Left channel of the track (and its length in frames), NULL while it is still being decoded or was never asked for
+const float * overview_pcm(const Overview * ov, size_t * frames, unsigned int * sample_rate);
+
+// Start decoding the left channel after a cache hit (the first seek), nothing when it is there or on its way
+void overview_want_pcm(Overview * ov);
+
+// Draw the part [from, to] (fractions of the track) into dest, constant time for any zoom: the level is picked so
+// every pixel covers one or two buckets
+void overview_draw(Overview * ov, Rectangle dest, float from, float to);
+
+// Stop the job (waits for it) and release everything
+void overview_free(Overview * ov);
+
+#endif // OVERVIEW_H_
@@ -0,0 +1,233 @@
+#define _DEFAULT_SOURCE // poll
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "pcm.h"
+
+static const char * FORMAT_NAMES[PCM_FORMAT_COUNT] = { "f32le", "s16le", "s32le", "u8" };
+static const size_t FORMAT_BYTES[PCM_FORMAT_COUNT] = { 4, 2, 4, 1 };
+
+bool pcm_parse_format(const char * name, PcmFormat * format)
+{
+    for (int f = 0; f < PCM_FORMAT_COUNT; f++) {
+        if (strcmp(name, FORMAT_NAMES[f]) == 0) {
+            *format = (PcmFormat) f;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char * pcm_format_name(PcmFormat format)
+{
+    return FORMAT_NAMES[format];
+}
+
+size_t pcm_frame_bytes(PcmConfig config)
+{
+    return FORMAT_BYTES[config.format] * config.channels;
+}
+
+// One little endian sample to [-1, 1]
+static float pcm_sample(const unsigned char * b, PcmFormat format)
+{
+    switch (format) {
+    case PCM_F32LE: {
+        const uint32_t bits = (uint32_t) b[0] | (uint32_t) b[1] << 8 | (uint32_t) b[2] << 16 | (uint32_t) b[3] << 24;
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+    case PCM_S16LE:
+        return (int16_t) (b[0] | b[1] << 8) / 32768.0f;
+    case PCM_S32LE:
+        return (int32_t) ((uint32_t) b[0] | (uint32_t) b[1] << 8 | (uint32_t) b[2] << 16 | (uint32_t) b[3] << 24) /
+               2147483648.0f;
+    case PCM_U8:
+        return (b[0] - 128) / 128.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+bool pcm_open(PcmInput * in, const char * path, PcmConfig config)
+{
+    memset(in, 0, sizeof(*in));
+    in->config = config;
+    if (config.sample_rate == 0 || config.channels == 0 || config.channels > PCM_MAX_CHANNELS) {
+        log_error("Unsupported raw PCM layout: %u Hz, %u channels", config.sample_rate, config.channels);
+        return false;
+    }
+
+    in->owns_fd = strcmp(path, "-") != 0;
+    in->fd = in->owns_fd ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (in->fd < 0) {
+        log_error("Could not open the raw PCM input: %s (%s)", path, strerror(errno));
+        return false;
+    }
+
+    in->raw = malloc(PCM_CHUNK_FRAMES * pcm_frame_bytes(config));
+    in->stereo = malloc(PCM_CHUNK_FRAMES * 2 * sizeof(float));
+    if (in->raw == NULL || in->stereo == NULL) {
+        log_error("Out of memory for the raw PCM input");
+        pcm_close(in);
+        return false;
+    }
+
+    pthread_mutex_init(&in->lock, NULL);
+    pthread_cond_init(&in->changed, NULL);
+    log_info("raw pcm: %s, %u Hz, %u channels, %s", in->owns_fd ? path : "stdin", config.sample_rate,
+             config.channels, pcm_format_name(config.format));
+    return true;
+}
+
+// Convert the whole frames in raw, push them and keep the partial one. Returns the frames pushed
+static size_t pcm_push(PcmInput * in)
+{
+    const PcmConfig config = in->config;
+    const size_t sample_bytes = FORMAT_BYTES[config.format];
+    const size_t frame_bytes = pcm_frame_bytes(config);
+    const size_t frames = in->raw_len / frame_bytes;
+    const size_t right = config.channels > 1 ? sample_bytes : 0;
+
+    for (size_t i = 0; i < frames; i++) {
+        const unsigned char * frame = in->raw + i * frame_bytes;
+        in->stereo[2 * i] = pcm_sample(frame, config.format);
+        in->stereo[2 * i + 1] = pcm_sample(frame + right, config.format);
+    }
+    if (in->meter != NULL) meter_process(in->meter, in->stereo, frames);
+    capture_push(in->capture, in->stereo, frames, 2);
+
+    in->raw_len -= frames * frame_bytes;
+    memmove(in->raw, in->raw + frames * frame_bytes, in->raw_len);
+    return frames;
+}
+
+static void * pcm_reader(void * arg)
+{
+    PcmInput * in = arg;
+    const size_t frame_bytes = pcm_frame_bytes(in->config);
+    const size_t capacity = PCM_CHUNK_FRAMES * frame_bytes;
+    const size_t keep = in->capture->mask + 1 - CAPTURE_MARGIN; // Same bound capture_window() checks
+
+    for (;;) {
+        // Room for a whole chunk without touching a window the consumer may still ask for
+        pthread_mutex_lock(&in->lock);
+        bool waited = false;
+        while (! in->stop && in->position + PCM_CHUNK_FRAMES > in->released + keep) {
+            waited = true;
+            pthread_cond_wait(&in->changed, &in->lock);
+        }
+        if (waited) in->stalls++;
+        const bool stop = in->stop;
+        pthread_mutex_unlock(&in->lock);
+        if (stop) break;
+
+        // Timed so a stop is noticed even when the producer is quiet
+        struct pollfd pfd = { .fd = in->fd, .events = POLLIN };
+        const int ready = poll(&pfd, 1, PCM_POLL_MS);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+
+        const ssize_t got = ready < 0 ? -1 : read(in->fd, in->raw + in->raw_len, capacity - in->raw_len);
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (got <= 0) {
+            if (got < 0) log_error("raw pcm: read failed (%s)", strerror(errno));
+            pthread_mutex_lock(&in->lock);
+            in->eof = true;
+            pthread_cond_broadcast(&in->changed);
+            pthread_mutex_unlock(&in->lock);
+            break;
+        }
+
+        in->raw_len += (size_t) got;
+        const size_t frames = pcm_push(in);
+        if (frames == 0) continue;
+
+        pthread_mutex_lock(&in->lock);
+        in->position += frames;
+        pthread_cond_broadcast(&in->changed);
+        pthread_mutex_unlock(&in->lock);
+    }
+    return NULL;
+}
+
+bool pcm_start(PcmInput * in, Capture * capture, Meter * meter)
+{
+    if (in->running) return true;
+
+    in->capture = capture;
+    in->meter = meter;
+    capture_reset(capture, in->position, NULL, 0);
+    in->released = in->position;
+    in->stop = false;
+    if (in->eof) return true; // Nothing left to read, the ring just stays empty
+
+    if (pthread_create(&in->thread, NULL, pcm_reader, in) != 0) {
+        log_error("Could not start the raw PCM reader");
+        return false;
+    }
+    in->running = true;
+    return true;
+}
+
+size_t pcm_wait(PcmInput * in, size_t position)
+{
+    pthread_mutex_lock(&in->lock);
+    while (in->position < position && ! in->eof && in->running) pthread_cond_wait(&in->changed, &in->lock);
+    const size_t end = in->position;
+    pthread_mutex_unlock(&in->lock);
+    return end;
+}
+
+void pcm_release(PcmInput * in, size_t position)
+{
+    pthread_mutex_lock(&in->lock);
+    if (position > in->released) {
+        in->released = position;
+        pthread_cond_broadcast(&in->changed);
+    }
+    pthread_mutex_unlock(&in->lock);
+}
+
+bool pcm_eof(PcmInput * in)
+{
+    pthread_mutex_lock(&in->lock);
+    const bool eof = in->eof;
+    pthread_mutex_unlock(&in->lock);
+    return eof;
+}
+
+void pcm_stop(PcmInput * in)
+{
+    if (! in->running) return;
+
+    pthread_mutex_lock(&in->lock);
+    in->stop = true;
+    pthread_cond_broadcast(&in->changed);
+    pthread_mutex_unlock(&in->lock);
+
+    pthread_join(in->thread, NULL);
+    in->running = false;
+}
+
+void pcm_close(PcmInput * in)
+{
+    if (in->raw != NULL && in->stereo != NULL) {
+        pcm_stop(in);
+        if (in->stalls > 0) log_info("raw pcm: reader waited for the analysis %zu times", in->stalls);
+        pthread_cond_destroy(&in->changed);
+        pthread_mutex_destroy(&in->lock);
+    }
+    if (in->owns_fd && in->fd >= 0) close(in->fd);
+    free(in->raw);
+    free(in->stereo);
+    memset(in, 0, sizeof(*in));
+    in->fd = -1;
+}
@@ -0,0 +1,88 @@
+#ifndef PCM_H_
+#define PCM_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "capture.h"
+#include "meter.h"
+
+#define PCM_CHUNK_FRAMES 4096     // Frames per read(), also the most the reader pushes at once (<= CAPTURE_MARGIN)
+#define PCM_MAX_CHANNELS 32
+#define PCM_POLL_MS 100           // Longest the reader sits in poll() before checking for a stop
+
+typedef enum {
+    PCM_F32LE,                    // 32 bit float
+    PCM_S16LE,                    // 16 bit signed
+    PCM_S32LE,                    // 32 bit signed
+    PCM_U8,                       // 8 bit unsigned (128 is silence)
+    PCM_FORMAT_COUNT,
+} PcmFormat;
+
+// Layout of the raw input, nothing in the stream describes it (ffmpeg -f f32le -ar 48000 -ac 2)
+typedef struct {
+    unsigned int sample_rate;
+    unsigned int channels;        // Interleaved
+    PcmFormat format;
+} PcmConfig;
+
+#define PCM_DEFAULT_CONFIG ((PcmConfig) { 48000, 2, PCM_F32LE })
+
+// Raw interleaved PCM read from stdin, a named pipe or a file by a reader thread, converted and pushed into a capture
+// ring with the same stream positions the music path uses. Memory stays bounded whatever the producer does: when
+// the ring is about to overwrite samples the consumer still needs, the reader stops reading and the pipe fills up
+// and blocks the producer instead
+typedef struct {
+    PcmConfig config;
+    int fd;
+    bool owns_fd;                 // Opened here (not stdin)
+
+    // Reader thread ---------------------------------------------------------------------------------------------------
+    Capture * capture;            // Ring filled by the reader (not owned)
+    Meter * meter;                // Fed with the first two channels, or NULL
+    unsigned char * raw;          // One chunk of input bytes
+    size_t raw_len;               // Bytes in raw, a partial frame stays there for the next read
+    float * stereo;               // One chunk converted to float stereo frames (mono is duplicated)
+    pthread_t thread;
+    bool running;                 // Thread started and not joined yet
+
+    // Shared (lock) ---------------------------------------------------------------------------------------------------
+    pthread_mutex_t lock;
+    pthread_cond_t changed;       // Signaled when frames were pushed, released, at EOF and on stop
+    size_t position;              // Stream position of the next frame read (frames so far)
+    size_t released;              // The consumer will not ask for a window starting before this position
+    size_t stalls;                // Times the reader waited for the consumer (producer faster than the analysis)
+    bool eof;                     // Input closed or failed, no more frames will come
+    bool stop;                    // Asked by pcm_stop()
+} PcmInput;
+
+// Format from its ffmpeg name (f32le, s16le, s32le, u8)
+bool pcm_parse_format(const char * name, PcmFormat * format);
+
+const char * pcm_format_name(PcmFormat format);
+
+// Bytes of one interleaved frame
+size_t pcm_frame_bytes(PcmConfig config);
+
+// Open path for reading ("-" is stdin). Opening a named pipe blocks until a writer opens it
+bool pcm_open(PcmInput * in, const char * path, PcmConfig config);
+
+// Start the reader thread filling capture (reset to the current position) and meter (NULL for none)
+bool pcm_start(PcmInput * in, Capture * capture, Meter * meter);
+
+// Block until the frames before position are in the ring or no more will come. Returns the captured end
+size_t pcm_wait(PcmInput * in, size_t position);
+
+// Windows will not start before position any more: the reader may overwrite what is older
+void pcm_release(PcmInput * in, size_t position);
+
+// Input ended and every frame read is in the ring
+bool pcm_eof(PcmInput * in);
+
+// Stop and join the reader thread, the capture ring is left alone afterwards (pcm_start() resumes)
+void pcm_stop(PcmInput * in);
+
+void pcm_close(PcmInput * in);
+
+#endif // PCM_H_
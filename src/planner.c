@@ -0,0 +1,205 @@
+#define _DEFAULT_SOURCE // mkdir, mkstemp, fdopen
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "logger.h"
+#include "planner.h"
+
+typedef struct {
+    size_t n;
+    FftKernel kernel;
+    double ns;                      // Per transform when it was measured
+} Wisdom;
+
+static pthread_mutex_t planner_lock = PTHREAD_MUTEX_INITIALIZER;
+static Wisdom wisdom[PLANNER_MAX_WISDOM];
+static size_t wisdom_count = 0;
+static bool wisdom_loaded = false;
+
+static bool kernel_from_name(const char * name, FftKernel * kernel)
+{
+    for (int k = 0; k < FFT_KERNEL_COUNT; k++) {
+        if (strcmp(name, fft_kernel_name((FftKernel) k)) == 0) {
+            *kernel = (FftKernel) k;
+            return true;
+        }
+    }
+    return false;
+}
+
+// $XDG_CACHE_HOME/musializer, or ~/.cache/musializer. Created when create is set. False when there is no home
+static bool cache_dir(char * out, size_t size, bool create)
+{
+    const char * xdg = getenv("XDG_CACHE_HOME");
+    const char * home = getenv("HOME");
+    char base[512];
+    if (xdg != NULL && xdg[0] != '\0') {
+        snprintf(base, sizeof(base), "%s", xdg);
+    } else if (home != NULL && home[0] != '\0') {
+        snprintf(base, sizeof(base), "%s/.cache", home);
+    } else {
+        return false;
+    }
+    snprintf(out, size, "%s/musializer", base);
+
+    if (create) {
+        if (mkdir(base, 0755) != 0 && errno != EEXIST) return false;
+        if (mkdir(out, 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+static bool wisdom_path(char * out, size_t size, bool create)
+{
+    char dir[600];
+    if (! cache_dir(dir, sizeof(dir), create)) return false;
+    snprintf(out, size, "%s/%s", dir, PLANNER_WISDOM_FILE);
+    return true;
+}
+
+// One "<n> <kernel> <ns>" per line, lines with an unknown kernel (older or newer build) are skipped
+static void wisdom_load(void)
+{
+    wisdom_loaded = true;
+    char path[700];
+    if (! wisdom_path(path, sizeof(path), false)) return;
+    FILE * file = fopen(path, "r");
+    if (file == NULL) return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), file) != NULL && wisdom_count < PLANNER_MAX_WISDOM) {
+        size_t n;
+        char name[32];
+        double ns;
+        FftKernel kernel;
+        if (line[0] == '#' || sscanf(line, "%zu %31s %lf", &n, name, &ns) != 3) continue;
+        if (! kernel_from_name(name, &kernel)) continue;
+        wisdom[wisdom_count++] = (Wisdom) { n, kernel, ns };
+    }
+    fclose(file);
+}
+
+// Whole file again, written to a unique file next to it and renamed so a reader never sees half of it. Two
+// processes saving at once each rename a complete file, the last one wins
+static void wisdom_save(void)
+{
+    char path[700], tmp[720];
+    if (! wisdom_path(path, sizeof(path), true)) return;
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+
+    const int fd = mkstemp(tmp);
+    FILE * file = fd < 0 ? NULL : fdopen(fd, "w");
+    if (file == NULL) {
+        log_warn("Could not write the FFT wisdom: %s", tmp);
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        return;
+    }
+    fchmod(fd, 0644); // mkstemp creates it owner only
+    fprintf(file, "# musializer FFT wisdom: <n> <kernel> <ns per transform>, delete to measure again\n");
+    for (size_t i = 0; i < wisdom_count; i++) {
+        fprintf(file, "%zu %s %.1f\n", wisdom[i].n, fft_kernel_name(wisdom[i].kernel), wisdom[i].ns);
+    }
+    if (fclose(file) != 0 || rename(tmp, path) != 0) {
+        log_warn("Could not write the FFT wisdom: %s", path);
+        unlink(tmp);
+    }
+}
+
+// Nanoseconds per transform of the plan with kernel, over PLANNER_TUNE_MS
+static double measure(FftPlan * plan, FftKernel kernel, const float * in, float complex * out)
+{
+    fft_plan_use(plan, kernel);
+    fft_plan_real(plan, in, out); // Warm the tables and buffers
+
+    size_t iterations = 0;
+    const double start = clock_seconds();
+    double elapsed = 0.0;
+    do {
+        for (int i = 0; i < 4; i++) fft_plan_real(plan, in, out);
+        iterations += 4;
+        elapsed = clock_seconds() - start;
+    } while (elapsed * 1000.0 < PLANNER_TUNE_MS);
+    return elapsed / iterations * 1e9;
+}
+
+FftKernel planner_tune(FftPlan * plan)
+{
+    const size_t n = plan->n;
+
+    const char * forced = getenv(PLANNER_KERNEL_ENV);
+    FftKernel kernel;
+    if (forced != NULL && forced[0] != '\0') {
+        if (kernel_from_name(forced, &kernel)) {
+            log_info("fft planner: n = %zu forced to %s", n, fft_kernel_name(kernel));
+            fft_plan_use(plan, kernel);
+            return kernel;
+        }
+        log_warn("Unknown FFT kernel in $%s: %s", PLANNER_KERNEL_ENV, forced);
+    }
+
+    // Held while measuring, so the other threads planning the same n get the result instead of timing again
+    pthread_mutex_lock(&planner_lock);
+    if (! wisdom_loaded) wisdom_load();
+    for (size_t i = 0; i < wisdom_count; i++) {
+        if (wisdom[i].n == n) {
+            kernel = wisdom[i].kernel;
+            pthread_mutex_unlock(&planner_lock);
+            log_info("fft planner: n = %zu uses %s from the wisdom", n, fft_kernel_name(kernel));
+            fft_plan_use(plan, kernel);
+            return kernel;
+        }
+    }
+
+    float * in = malloc(n * sizeof(float));
+    float complex * out = malloc(n * sizeof(float complex));
+    if (in == NULL || out == NULL) {
+        pthread_mutex_unlock(&planner_lock);
+        free(in);
+        free(out);
+        return plan->kernel;
+    }
+    // Same noise on every run from a local generator, the process wide rand() sequence is left alone
+    uint32_t seed = 1;
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        in[i] = (float) (seed >> 8) / (1u << 24) * 2.0f - 1.0f;
+    }
+
+    char report[256] = "";
+    size_t len = 0;
+    double best = 0.0;
+    kernel = plan->kernel;
+    for (int k = 0; k < FFT_KERNEL_COUNT; k++) {
+        const double ns = measure(plan, (FftKernel) k, in, out);
+        if (k == 0 || ns < best) {
+            best = ns;
+            kernel = (FftKernel) k;
+        }
+        if (len < sizeof(report)) {
+            len += snprintf(report + len, sizeof(report) - len, " %s %.0f ns", fft_kernel_name((FftKernel) k), ns);
+        }
+    }
+    free(in);
+    free(out);
+
+    if (wisdom_count < PLANNER_MAX_WISDOM) {
+        wisdom[wisdom_count++] = (Wisdom) { n, kernel, best };
+        wisdom_save();
+    }
+    pthread_mutex_unlock(&planner_lock);
+
+    log_info("fft planner: n = %zu measured%s, using %s", n, report, fft_kernel_name(kernel));
+    fft_plan_use(plan, kernel);
+    return kernel;
+}
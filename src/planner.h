@@ -0,0 +1,18 @@
+#ifndef PLANNER_H_
+#define PLANNER_H_
+
+#include <stddef.h>
+
+#include "fft.h"
+
+#define PLANNER_KERNEL_ENV "MUSIALIZER_FFT_KERNEL" // Force a kernel by name (reproducible benchmarks)
+#define PLANNER_TUNE_MS 5.0                        // Time spent measuring each candidate kernel
+#define PLANNER_MAX_WISDOM 64                      // Sizes remembered
+#define PLANNER_WISDOM_FILE "fft-wisdom"           // In $XDG_CACHE_HOME/musializer (or ~/.cache/musializer)
+
+// Pick the kernel of a fresh plan: the one forced by $MUSIALIZER_FFT_KERNEL, the one the wisdom file remembers for
+// this n, or else every candidate is timed for PLANNER_TUNE_MS on this plan and the fastest one is remembered and
+// written back to the wisdom file. Thread safe: concurrent callers with the same n measure only once
+FftKernel planner_tune(FftPlan * plan);
+
+#endif // PLANNER_H_
@@ -0,0 +1,568 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "logger.h"
+#include "png.h"
+
+#define PNG_MAX_DISTANCE 32768      // Deflate window
+#define PNG_MIN_MATCH 3
+#define PNG_MAX_MATCH 258
+#define PNG_LITLEN 286              // Literal/length alphabet: bytes, end of block, lengths
+#define PNG_FIXED_LITLEN 288        // The fixed code also counts the 2 unused symbols, they shift the 9 bit codes
+#define PNG_DIST 30
+#define PNG_CLEN 19                 // Alphabet of the code lengths of a dynamic block
+#define PNG_MAX_BITS 15             // Longest literal/length or distance code
+#define PNG_MAX_CLEN_BITS 7
+#define PNG_MATCH 0x80000000u       // Token flag: a match, length << 15 | distance - 1, else a literal
+#define PNG_HASH_BITS 15            // Last position of each hashed 3 byte sequence, one candidate like zlib's level 1
+#define ADLER_BASE 65521
+#define ADLER_NMAX 5552             // Bytes summed before s2 could overflow 32 bits
+
+// Symbols and extra bits of every match length and distance, the CRC table
+typedef struct {
+    uint16_t len_sym[PNG_MAX_MATCH + 1];
+    uint8_t len_extra[PNG_MAX_MATCH + 1];
+    uint16_t len_value[PNG_MAX_MATCH + 1];
+    uint8_t dist_near[256];         // Symbol of distance d <= 256 at d - 1
+    uint8_t dist_far[256];          // Symbol of a longer distance at (d - 1) >> 7
+    uint16_t dist_base[PNG_DIST];
+    uint8_t dist_extra[PNG_DIST];
+    uint32_t crc[256];
+} PngTables;
+
+typedef struct {
+    const unsigned char * rgb;
+    size_t width;
+    size_t height;
+    size_t stride;                  // Filtered bytes per row: the filter type, then 3 per pixel
+    PngTables tables;
+    unsigned char ** scratch;       // Per worker, PNG_STRIP_ROWS filtered rows
+    uint32_t ** tokens;             // Per worker, one per filtered byte at most
+    uint32_t ** heads;              // Per worker hash table, position + 1 of the last sequence (0: none)
+} PngImage;
+
+// Rows [first, first + rows), deflated into out
+typedef struct {
+    const PngImage * image;
+    size_t first;
+    size_t rows;
+    bool last;
+    unsigned char * out;            // Capacity strip_bound()
+    size_t len;
+    uint32_t adler;                 // Of the filtered rows
+    uint32_t crc;                   // Of the IDAT chunk type and out
+} PngStrip;
+
+// One alphabet of a block: bit reversed codes, ready to be written LSB first
+typedef struct {
+    uint32_t code[PNG_FIXED_LITLEN];
+    uint8_t bits[PNG_FIXED_LITLEN];
+} Huffman;
+
+// LSB first bit writer of deflate
+typedef struct {
+    unsigned char * out;
+    size_t len;
+    uint64_t bits;
+    unsigned int count;
+} Bits;
+
+static inline void put_bits(Bits * b, uint32_t value, unsigned int n)
+{
+    b->bits |= (uint64_t) value << b->count;
+    b->count += n;
+    while (b->count >= 8) {
+        b->out[b->len++] = (unsigned char) b->bits;
+        b->bits >>= 8;
+        b->count -= 8;
+    }
+}
+
+static inline void align_bits(Bits * b)
+{
+    if (b->count > 0) put_bits(b, 0, 8 - b->count);
+}
+
+static uint32_t reverse(uint32_t code, unsigned int n)
+{
+    uint32_t r = 0;
+    for (unsigned int i = 0; i < n; i++) r |= ((code >> i) & 1) << (n - 1 - i);
+    return r;
+}
+
+static void tables_init(PngTables * t)
+{
+    static const uint16_t len_base[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227,
+        258
+    };
+    static const uint8_t len_extra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+
+    for (unsigned int code = 0; code < 29; code++) {
+        const unsigned int end = code == 28 ? PNG_MAX_MATCH + 1 : len_base[code + 1];
+        for (unsigned int len = len_base[code]; len < end; len++) {
+            t->len_sym[len] = (uint16_t) (257 + code);
+            t->len_extra[len] = len_extra[code];
+            t->len_value[len] = (uint16_t) (len - len_base[code]);
+        }
+    }
+
+    // Codes 0-3 are distances 1-4, then every pair of codes doubles the range with one more extra bit
+    unsigned int base = 1;
+    for (unsigned int code = 0; code < PNG_DIST; code++) {
+        t->dist_base[code] = (uint16_t) base;
+        t->dist_extra[code] = (uint8_t) (code < 4 ? 0 : (code - 2) / 2);
+        for (unsigned int d = base; d < base + (1u << t->dist_extra[code]); d++) {
+            if (d <= 256) t->dist_near[d - 1] = (uint8_t) code;
+            else t->dist_far[(d - 1) >> 7] = (uint8_t) code;
+        }
+        base += 1u << t->dist_extra[code];
+    }
+
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t->crc[n] = c;
+    }
+}
+
+// Code lengths of the fixed block (RFC 1951 3.2.6)
+static void fixed_huffman(Huffman * lit, Huffman * dist)
+{
+    for (unsigned int s = 0; s < PNG_FIXED_LITLEN; s++) lit->bits[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+    for (unsigned int s = 0; s < PNG_DIST; s++) dist->bits[s] = 5;
+}
+
+// Huffman code lengths of freq, none longer than limit. Leaves sorted by weight, internal nodes appended in the
+// order they are made (their weights never decrease), so the two lightest are always at one of the two fronts. When
+// the tree is too deep the weights are halved (a used symbol stays at least 1) and the tree is built again
+static void huffman_lengths(const uint32_t * freq, size_t n, unsigned int limit, uint8_t * bits)
+{
+    uint32_t f[PNG_LITLEN];
+    size_t order[PNG_LITLEN];
+    uint64_t weight[2 * PNG_LITLEN];
+    size_t parent[2 * PNG_LITLEN];
+    unsigned int depth[2 * PNG_LITLEN];
+    for (size_t i = 0; i < n; i++) f[i] = freq[i];
+
+    for (;;) {
+        size_t leaves = 0;
+        for (size_t i = 0; i < n; i++) {
+            bits[i] = 0;
+            if (f[i] == 0) continue;
+            size_t k = leaves++;
+            for (; k > 0 && f[order[k - 1]] > f[i]; k--) order[k] = order[k - 1];
+            order[k] = i;
+        }
+        if (leaves == 0) return;
+        if (leaves == 1) {
+            bits[order[0]] = 1;
+            return;
+        }
+
+        for (size_t k = 0; k < leaves; k++) weight[k] = f[order[k]];
+        size_t next_leaf = 0, next_node = leaves, nodes = leaves;
+        while (nodes < 2 * leaves - 1) {
+            size_t pick[2];
+            for (int j = 0; j < 2; j++) {
+                const bool leaf = next_leaf < leaves && (next_node >= nodes || weight[next_leaf] <= weight[next_node]);
+                pick[j] = leaf ? next_leaf++ : next_node++;
+            }
+            weight[nodes] = weight[pick[0]] + weight[pick[1]];
+            parent[pick[0]] = parent[pick[1]] = nodes;
+            nodes++;
+        }
+
+        // Parents come after their children: one backward pass from the root
+        unsigned int longest = 0;
+        depth[nodes - 1] = 0;
+        for (size_t k = nodes - 1; k-- > 0;) depth[k] = depth[parent[k]] + 1;
+        for (size_t k = 0; k < leaves; k++) {
+            bits[order[k]] = (uint8_t) depth[k];
+            if (depth[k] > longest) longest = depth[k];
+        }
+        if (longest <= limit) return;
+        for (size_t i = 0; i < n; i++) {
+            if (f[i] > 0) f[i] = (f[i] >> 1) | 1;
+        }
+    }
+}
+
+// Canonical codes from the lengths
+static void huffman_codes(Huffman * h, size_t n)
+{
+    unsigned int count[PNG_MAX_BITS + 1] = { 0 };
+    uint32_t next[PNG_MAX_BITS + 1] = { 0 };
+    for (size_t i = 0; i < n; i++) count[h->bits[i]]++;
+    count[0] = 0;
+    uint32_t code = 0;
+    for (unsigned int b = 1; b <= PNG_MAX_BITS; b++) {
+        code = (code + count[b - 1]) << 1;
+        next[b] = code;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (h->bits[i] > 0) h->code[i] = reverse(next[h->bits[i]]++, h->bits[i]);
+    }
+}
+
+// At least two used symbols, the smallest complete code every decoder accepts
+static void ensure_two(uint32_t * freq, size_t n)
+{
+    size_t used = 0;
+    for (size_t i = 0; i < n; i++) used += freq[i] > 0;
+    for (size_t i = 0; used < 2 && i < n; i++) {
+        if (freq[i] == 0) {
+            freq[i] = 1;
+            used++;
+        }
+    }
+}
+
+// Run length code of the lengths of a dynamic block: 16 repeats the previous length 3-6 times, 17 and 18 are runs
+// of 3-10 and 11-138 zeros. Returns the number of symbols
+static size_t rle_lengths(const uint8_t * lens, size_t n, uint8_t * sym, uint8_t * extra)
+{
+    size_t out = 0;
+    for (size_t i = 0; i < n;) {
+        const uint8_t v = lens[i];
+        size_t run = 1;
+        while (i + run < n && lens[i + run] == v) run++;
+        if (v == 0 && run >= 3) {
+            const size_t r = run < 138 ? run : 138;
+            sym[out] = r >= 11 ? 18 : 17;
+            extra[out++] = (uint8_t) (r >= 11 ? r - 11 : r - 3);
+            i += r;
+        } else if (v != 0 && run >= 4) {
+            const size_t r = run - 1 < 6 ? run - 1 : 6;
+            sym[out] = v;
+            extra[out++] = 0;
+            sym[out] = 16;
+            extra[out++] = (uint8_t) (r - 3);
+            i += 1 + r;
+        } else {
+            sym[out] = v;
+            extra[out++] = 0;
+            i++;
+        }
+    }
+    return out;
+}
+
+// Header of a dynamic block after BFINAL and BTYPE, written when out is not NULL. Returns its size in bits
+static size_t dynamic_header(Bits * out, const Huffman * lit, const Huffman * dist)
+{
+    static const uint8_t clen_order[PNG_CLEN] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    static const uint8_t clen_extra[PNG_CLEN] = { [16] = 2, [17] = 3, [18] = 7 };
+
+    size_t hlit = PNG_LITLEN, hdist = PNG_DIST;
+    while (hlit > 257 && lit->bits[hlit - 1] == 0) hlit--;
+    while (hdist > 1 && dist->bits[hdist - 1] == 0) hdist--;
+
+    uint8_t lens[PNG_LITLEN + PNG_DIST], sym[PNG_LITLEN + PNG_DIST], extra[PNG_LITLEN + PNG_DIST];
+    for (size_t i = 0; i < hlit; i++) lens[i] = lit->bits[i];
+    for (size_t i = 0; i < hdist; i++) lens[hlit + i] = dist->bits[i];
+    const size_t count = rle_lengths(lens, hlit + hdist, sym, extra);
+
+    uint32_t freq[PNG_CLEN] = { 0 };
+    for (size_t i = 0; i < count; i++) freq[sym[i]]++;
+    ensure_two(freq, PNG_CLEN);
+    Huffman clen;
+    huffman_lengths(freq, PNG_CLEN, PNG_MAX_CLEN_BITS, clen.bits);
+    huffman_codes(&clen, PNG_CLEN);
+    size_t hclen = PNG_CLEN;
+    while (hclen > 4 && clen.bits[clen_order[hclen - 1]] == 0) hclen--;
+
+    size_t size = 5 + 5 + 4 + 3 * hclen;
+    for (size_t i = 0; i < count; i++) size += clen.bits[sym[i]] + clen_extra[sym[i]];
+    if (out == NULL) return size;
+
+    put_bits(out, (uint32_t) (hlit - 257), 5);
+    put_bits(out, (uint32_t) (hdist - 1), 5);
+    put_bits(out, (uint32_t) (hclen - 4), 4);
+    for (size_t i = 0; i < hclen; i++) put_bits(out, clen.bits[clen_order[i]], 3);
+    for (size_t i = 0; i < count; i++) {
+        put_bits(out, clen.code[sym[i]], clen.bits[sym[i]]);
+        if (clen_extra[sym[i]] > 0) put_bits(out, extra[i], clen_extra[sym[i]]);
+    }
+    return size;
+}
+
+// Bits of the symbols of a block under a code (the extra bits are the same whatever the code)
+static size_t symbol_bits(const uint32_t * lit_freq, const uint32_t * dist_freq, const Huffman * lit,
+                          const Huffman * dist)
+{
+    size_t size = 0;
+    for (size_t s = 0; s < PNG_LITLEN; s++) size += (size_t) lit_freq[s] * lit->bits[s];
+    for (size_t s = 0; s < PNG_DIST; s++) size += (size_t) dist_freq[s] * dist->bits[s];
+    return size;
+}
+
+static uint32_t crc_update(const PngTables * t, uint32_t crc, const unsigned char * p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) crc = t->crc[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static uint32_t adler_update(uint32_t adler, const unsigned char * p, size_t n)
+{
+    uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+    while (n > 0) {
+        const size_t chunk = n < ADLER_NMAX ? n : ADLER_NMAX;
+        for (size_t i = 0; i < chunk; i++) {
+            s1 += p[i];
+            s2 += s1;
+        }
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+        p += chunk;
+        n -= chunk;
+    }
+    return s1 | s2 << 16;
+}
+
+// Adler-32 of A then B from adler(A), adler(B) and the length of B (as zlib's adler32_combine)
+static uint32_t adler_combine(uint32_t a, uint32_t b, size_t len_b)
+{
+    const uint32_t rem = (uint32_t) (len_b % ADLER_BASE);
+    uint32_t s1 = a & 0xFFFF;
+    uint32_t s2 = (uint32_t) (((uint64_t) rem * s1) % ADLER_BASE);
+    s1 += (b & 0xFFFF) + ADLER_BASE - 1;
+    s2 += (a >> 16) + (b >> 16) + ADLER_BASE - rem;
+    if (s1 >= ADLER_BASE) s1 -= ADLER_BASE;
+    if (s1 >= ADLER_BASE) s1 -= ADLER_BASE;
+    if (s2 >= 2 * ADLER_BASE) s2 -= 2 * ADLER_BASE;
+    if (s2 >= ADLER_BASE) s2 -= ADLER_BASE;
+    return s1 | s2 << 16;
+}
+
+// Bytes a strip of rows can take: the block is never above the fixed codes, at most 9 bits per byte (a match of 3
+// costs 7 + 5 + 13 = 25 bits at worst), plus the block headers and the flush
+static size_t strip_bound(size_t stride, size_t rows)
+{
+    return stride * rows * 9 / 8 + 16;
+}
+
+static inline size_t match_length(const unsigned char * p, size_t i, size_t distance, size_t n)
+{
+    const size_t max = n - i < PNG_MAX_MATCH ? n - i : PNG_MAX_MATCH;
+    size_t len = 0;
+    while (len < max && p[i + len] == p[i + len - distance]) len++;
+    return len;
+}
+
+static void deflate_strip(void * arg, size_t worker)
+{
+    PngStrip * strip = arg;
+    const PngImage * image = strip->image;
+    const PngTables * t = &image->tables;
+    const size_t stride = image->stride;
+    const size_t n = strip->rows * stride;
+    unsigned char * raw = image->scratch[worker];
+    uint32_t * tokens = image->tokens[worker];
+    uint32_t * heads = image->heads[worker];
+    memset(heads, 0, sizeof(uint32_t) << PNG_HASH_BITS);
+
+    // Sub filter: each byte minus the same channel of the pixel on its left
+    for (size_t r = 0; r < strip->rows; r++) {
+        const unsigned char * src = image->rgb + (strip->first + r) * (stride - 1);
+        unsigned char * dst = raw + r * stride;
+        dst[0] = 1;
+        for (size_t x = 0; x < 3 && x < stride - 1; x++) dst[1 + x] = src[x];
+        for (size_t x = 3; x < stride - 1; x++) dst[1 + x] = (unsigned char) (src[x] - src[x - 3]);
+    }
+
+    // Greedy matches, inside the strip only: the longest of the previous pixel, the row above and the last place the
+    // next 3 bytes were seen (the same color after the same step shows up all over a spectrogram)
+    const size_t up = stride <= PNG_MAX_DISTANCE ? stride : 0;
+    uint32_t lit_freq[PNG_LITLEN] = { 0 }, dist_freq[PNG_DIST] = { 0 };
+    size_t count = 0;
+    for (size_t i = 0; i < n;) {
+        size_t len = 0, distance = 0;
+        if (i + PNG_MIN_MATCH <= n) {
+            const uint32_t key = (uint32_t) raw[i] | (uint32_t) raw[i + 1] << 8 | (uint32_t) raw[i + 2] << 16;
+            const uint32_t h = (key * 2654435761u) >> (32 - PNG_HASH_BITS);
+            const size_t candidates[3] = { 3, up, heads[h] > 0 ? i + 1 - heads[h] : 0 };
+            heads[h] = (uint32_t) (i + 1);
+            for (int c = 0; c < 3; c++) {
+                const size_t dc = candidates[c];
+                if (dc == 0 || dc > i || dc > PNG_MAX_DISTANCE || (c == 2 && (dc == 3 || dc == up))) continue;
+                const size_t lc = match_length(raw, i, dc, n);
+                if (lc > len) {
+                    len = lc;
+                    distance = dc;
+                }
+            }
+        }
+        if (len >= PNG_MIN_MATCH) {
+            tokens[count++] = PNG_MATCH | (uint32_t) len << 15 | (uint32_t) (distance - 1);
+            lit_freq[t->len_sym[len]]++;
+            dist_freq[distance <= 256 ? t->dist_near[distance - 1] : t->dist_far[(distance - 1) >> 7]]++;
+            i += len;
+        } else {
+            tokens[count++] = raw[i];
+            lit_freq[raw[i]]++;
+            i++;
+        }
+    }
+    lit_freq[256]++; // End of block
+
+    // Codes of this strip against the fixed ones, whichever block is smaller
+    Huffman lit, dist, fixed_lit, fixed_dist;
+    uint32_t lit_used[PNG_LITLEN], dist_used[PNG_DIST];
+    for (size_t s = 0; s < PNG_LITLEN; s++) lit_used[s] = lit_freq[s];
+    for (size_t s = 0; s < PNG_DIST; s++) dist_used[s] = dist_freq[s];
+    ensure_two(lit_used, PNG_LITLEN);
+    ensure_two(dist_used, PNG_DIST);
+    huffman_lengths(lit_used, PNG_LITLEN, PNG_MAX_BITS, lit.bits);
+    huffman_lengths(dist_used, PNG_DIST, PNG_MAX_BITS, dist.bits);
+    fixed_huffman(&fixed_lit, &fixed_dist);
+    const size_t dynamic_size = dynamic_header(NULL, &lit, &dist) + symbol_bits(lit_freq, dist_freq, &lit, &dist);
+    const bool dynamic = dynamic_size < symbol_bits(lit_freq, dist_freq, &fixed_lit, &fixed_dist);
+    const Huffman * use_lit = dynamic ? &lit : &fixed_lit;
+    const Huffman * use_dist = dynamic ? &dist : &fixed_dist;
+    huffman_codes(&lit, PNG_LITLEN);
+    huffman_codes(&dist, PNG_DIST);
+    huffman_codes(&fixed_lit, PNG_FIXED_LITLEN);
+    huffman_codes(&fixed_dist, PNG_DIST);
+
+    Bits b = { .out = strip->out };
+    put_bits(&b, strip->last ? 1 : 0, 1); // BFINAL
+    put_bits(&b, dynamic ? 2 : 1, 2);     // Dynamic or fixed Huffman codes
+    if (dynamic) dynamic_header(&b, &lit, &dist);
+    for (size_t k = 0; k < count; k++) {
+        const uint32_t token = tokens[k];
+        if (token & PNG_MATCH) {
+            const size_t len = (token & ~PNG_MATCH) >> 15;
+            const size_t distance = (token & 0x7FFF) + 1;
+            const unsigned int sym = t->len_sym[len];
+            put_bits(&b, use_lit->code[sym], use_lit->bits[sym]);
+            if (t->len_extra[len] > 0) put_bits(&b, t->len_value[len], t->len_extra[len]);
+            const unsigned int dsym = distance <= 256 ? t->dist_near[distance - 1] : t->dist_far[(distance - 1) >> 7];
+            put_bits(&b, use_dist->code[dsym], use_dist->bits[dsym]);
+            if (t->dist_extra[dsym] > 0) put_bits(&b, (uint32_t) (distance - t->dist_base[dsym]), t->dist_extra[dsym]);
+        } else {
+            put_bits(&b, use_lit->code[token], use_lit->bits[token]);
+        }
+    }
+    put_bits(&b, use_lit->code[256], use_lit->bits[256]);
+    if (! strip->last) {
+        put_bits(&b, 0, 3); // Empty stored block: aligned, LEN 0, NLEN 0xFFFF
+        align_bits(&b);
+        put_bits(&b, 0x0000, 16);
+        put_bits(&b, 0xFFFF, 16);
+    }
+    align_bits(&b);
+    assert(b.len <= strip_bound(stride, strip->rows));
+
+    strip->len = b.len;
+    strip->adler = adler_update(1, raw, n);
+    strip->crc = crc_update(t, crc_update(t, 0xFFFFFFFFu, (const unsigned char *) "IDAT", 4), strip->out, b.len);
+}
+
+static void put_u32(unsigned char * p, uint32_t v)
+{
+    p[0] = (unsigned char) (v >> 24);
+    p[1] = (unsigned char) (v >> 16);
+    p[2] = (unsigned char) (v >> 8);
+    p[3] = (unsigned char) v;
+}
+
+// Length, type, data and the CRC (computed when crc is 0)
+static bool write_chunk(FILE * file, const PngTables * t, const char * type, const unsigned char * data, size_t len,
+                        uint32_t crc)
+{
+    unsigned char head[8], tail[4];
+    put_u32(head, (uint32_t) len);
+    for (int i = 0; i < 4; i++) head[4 + i] = (unsigned char) type[i];
+    if (crc == 0) crc = crc_update(t, crc_update(t, 0xFFFFFFFFu, head + 4, 4), data, len);
+    put_u32(tail, crc ^ 0xFFFFFFFFu);
+    return fwrite(head, 1, 8, file) == 8 && (len == 0 || fwrite(data, 1, len, file) == len) &&
+           fwrite(tail, 1, 4, file) == 4;
+}
+
+bool png_write(const char * path, const unsigned char * rgb, size_t width, size_t height, Pool * pool)
+{
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    assert(width > 0 && height > 0);
+
+    const size_t stride = 1 + 3 * width;
+    const size_t strips = (height + PNG_STRIP_ROWS - 1) / PNG_STRIP_ROWS;
+    const size_t capacity = ARENA_ALIGN(sizeof(PngImage))
+                          + 3 * ARENA_ALIGN(pool->workers * sizeof(void *))
+                          + pool->workers * ARENA_ALIGN(sizeof(uint32_t) << PNG_HASH_BITS)
+                          + pool->workers * ARENA_ALIGN(PNG_STRIP_ROWS * stride)
+                          + pool->workers * ARENA_ALIGN(PNG_STRIP_ROWS * stride * sizeof(uint32_t))
+                          + ARENA_ALIGN(strips * sizeof(PngStrip))
+                          + strips * ARENA_ALIGN(strip_bound(stride, PNG_STRIP_ROWS));
+    Arena arena = { 0 };
+    PngImage * image = NULL;
+    PngStrip * strip = NULL;
+    bool ok = arena_reserve(&arena, capacity) &&
+              (image = arena_alloc(&arena, sizeof(PngImage))) != NULL &&
+              (image->scratch = arena_alloc(&arena, pool->workers * sizeof(unsigned char *))) != NULL &&
+              (image->tokens = arena_alloc(&arena, pool->workers * sizeof(uint32_t *))) != NULL &&
+              (image->heads = arena_alloc(&arena, pool->workers * sizeof(uint32_t *))) != NULL &&
+              (strip = arena_alloc(&arena, strips * sizeof(PngStrip))) != NULL;
+    for (size_t w = 0; ok && w < pool->workers; w++) {
+        ok = (image->scratch[w] = arena_alloc(&arena, PNG_STRIP_ROWS * stride)) != NULL &&
+             (image->tokens[w] = arena_alloc(&arena, PNG_STRIP_ROWS * stride * sizeof(uint32_t))) != NULL &&
+             (image->heads[w] = arena_alloc(&arena, sizeof(uint32_t) << PNG_HASH_BITS)) != NULL;
+    }
+    for (size_t s = 0; ok && s < strips; s++) {
+        ok = (strip[s].out = arena_alloc(&arena, strip_bound(stride, PNG_STRIP_ROWS))) != NULL;
+    }
+    if (! ok) {
+        log_error("Out of memory encoding a %zu x %zu PNG", width, height);
+        arena_free(&arena);
+        return false;
+    }
+
+    image->rgb = rgb;
+    image->width = width;
+    image->height = height;
+    image->stride = stride;
+    tables_init(&image->tables);
+    for (size_t s = 0; s < strips; s++) {
+        strip[s].image = image;
+        strip[s].first = s * PNG_STRIP_ROWS;
+        strip[s].rows = height - strip[s].first < PNG_STRIP_ROWS ? height - strip[s].first : PNG_STRIP_ROWS;
+        strip[s].last = s == strips - 1;
+        if (! pool_submit(pool, deflate_strip, &strip[s])) ok = false;
+    }
+    pool_wait(pool);
+    if (! ok) {
+        arena_free(&arena);
+        return false;
+    }
+
+    // Header: 8 bit truecolor, no interlace. Then the zlib header (deflate, 32K window, fastest), the strips and the
+    // Adler-32 of everything, each in its own IDAT
+    unsigned char ihdr[13] = { 0 };
+    put_u32(ihdr, (uint32_t) width);
+    put_u32(ihdr + 4, (uint32_t) height);
+    ihdr[8] = 8;
+    ihdr[9] = 2;
+    static const unsigned char zlib_header[2] = { 0x78, 0x01 };
+    uint32_t adler = strip[0].adler;
+    for (size_t s = 1; s < strips; s++) adler = adler_combine(adler, strip[s].adler, strip[s].rows * stride);
+    unsigned char trailer[4];
+    put_u32(trailer, adler);
+
+    const PngTables * t = &image->tables;
+    FILE * file = fopen(path, "wb");
+    ok = file != NULL && fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+         write_chunk(file, t, "IHDR", ihdr, sizeof(ihdr), 0) &&
+         write_chunk(file, t, "IDAT", zlib_header, sizeof(zlib_header), 0);
+    for (size_t s = 0; ok && s < strips; s++) {
+        ok = write_chunk(file, t, "IDAT", strip[s].out, strip[s].len, strip[s].crc);
+    }
+    ok = ok && write_chunk(file, t, "IDAT", trailer, sizeof(trailer), 0) && write_chunk(file, t, "IEND", NULL, 0, 0);
+    if (file != NULL && fclose(file) != 0) ok = false;
+    arena_free(&arena);
+    return ok;
+}
@@ -0,0 +1,23 @@
+#ifndef PNG_H_
+#define PNG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pool.h"
+
+#define PNG_STRIP_ROWS 32           // Rows compressed by one pool task
+
+// 8 bit RGB PNG encoder for the large offline images, compressing on a pool instead of one thread. Every row uses
+// the Sub filter (a column of a spectrogram is close to the one before it), then each strip of PNG_STRIP_ROWS rows is
+// deflated on its own into one block: greedy matches against the previous pixel, the row above and the last place
+// the same 3 bytes were seen, with Huffman codes built for the strip (or the fixed ones when smaller). A strip ends
+// with an empty stored block (a sync flush), which leaves it byte aligned, so the strips are written back to back as
+// consecutive IDAT chunks with their own CRC and the Adler-32 of the strips is combined at the end. About the size
+// and speed of zlib's level 1 on one core, split over every core
+//
+// Writes width x height pixels of rgb (3 bytes each, row by row, top row first) to path. Call it from outside the
+// pool. Returns false when out of memory or when the file cannot be written
+bool png_write(const char * path, const unsigned char * rgb, size_t width, size_t height, Pool * pool);
+
+#endif // PNG_H_
@@ -0,0 +1,225 @@
+#define _DEFAULT_SOURCE // sysconf
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "pool.h"
+
+#define POOL_DEQUE_CAPACITY 64 // Initial tasks per deque, grows when full
+
+typedef struct {
+    Pool * pool;
+    size_t index;
+} PoolWorker;
+
+// Pool and worker index of the calling thread (NULL / SIZE_MAX outside of any pool)
+static __thread Pool * current_pool = NULL;
+static __thread size_t current_worker = (size_t) -1;
+
+size_t pool_cores(void)
+{
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : (size_t) cores;
+}
+
+static bool deque_push(PoolDeque * deque, PoolTask task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail - deque->head == deque->capacity) {
+        // Full: double and unwrap into the new ring
+        const size_t capacity = deque->capacity * 2;
+        PoolTask * tasks = malloc(capacity * sizeof(PoolTask));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+        for (size_t i = deque->head; i < deque->tail; i++) {
+            tasks[i & (capacity - 1)] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+    deque->tasks[deque->tail & (deque->capacity - 1)] = task;
+    deque->tail++;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+static bool deque_pop_tail(PoolDeque * deque, PoolTask * task)
+{
+    bool ok = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail != deque->head) {
+        deque->tail--;
+        *task = deque->tasks[deque->tail & (deque->capacity - 1)];
+        ok = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return ok;
+}
+
+static bool deque_steal_head(PoolDeque * deque, PoolTask * task)
+{
+    bool ok = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail != deque->head) {
+        *task = deque->tasks[deque->head & (deque->capacity - 1)];
+        deque->head++;
+        ok = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return ok;
+}
+
+// Own deque first, then every other worker starting with the next one
+static bool take(Pool * pool, size_t self, PoolTask * task)
+{
+    bool ok = deque_pop_tail(&pool->deques[self], task);
+    for (size_t i = 1; ! ok && i < pool->workers; i++) {
+        ok = deque_steal_head(&pool->deques[(self + i) % pool->workers], task);
+    }
+
+    if (ok) {
+        pthread_mutex_lock(&pool->lock);
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return ok;
+}
+
+static void * pool_worker(void * arg)
+{
+    PoolWorker * worker = arg;
+    Pool * pool = worker->pool;
+    const size_t self = worker->index;
+    free(worker);
+
+    current_pool = pool;
+    current_worker = self;
+
+    for (;;) {
+        PoolTask task;
+        if (take(pool, self, &task)) {
+            task.fn(task.arg, self);
+
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0) pthread_cond_broadcast(&pool->idle);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && ! pool->stop) pthread_cond_wait(&pool->wake, &pool->lock);
+        const bool stop = pool->stop && pool->queued == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) return NULL;
+    }
+}
+
+// Stop and join the first started workers, then release the memory (pool is zeroed)
+static void pool_release(Pool * pool, size_t started)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < started; i++) pthread_join(pool->threads[i], NULL);
+
+    if (pool->deques != NULL) {
+        for (size_t i = 0; i < pool->workers; i++) {
+            free(pool->deques[i].tasks);
+            pthread_mutex_destroy(&pool->deques[i].lock);
+        }
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->deques);
+    free(pool->threads);
+    memset(pool, 0, sizeof(*pool));
+}
+
+bool pool_init(Pool * pool, size_t workers)
+{
+    memset(pool, 0, sizeof(*pool));
+    if (workers == 0) workers = pool_cores();
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    pool->workers = workers;
+    pool->threads = calloc(workers, sizeof(pthread_t));
+    pool->deques = calloc(workers, sizeof(PoolDeque));
+    if (pool->threads == NULL || pool->deques == NULL) {
+        free(pool->deques);
+        pool->deques = NULL; // No deque lock to destroy yet
+        pool_release(pool, 0);
+        return false;
+    }
+
+    // Every lock exists before anything can fail, pool_release destroys them all
+    for (size_t i = 0; i < workers; i++) pthread_mutex_init(&pool->deques[i].lock, NULL);
+    for (size_t i = 0; i < workers; i++) {
+        pool->deques[i].capacity = POOL_DEQUE_CAPACITY;
+        pool->deques[i].tasks = malloc(POOL_DEQUE_CAPACITY * sizeof(PoolTask));
+        if (pool->deques[i].tasks == NULL) {
+            pool_release(pool, 0);
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < workers; i++) {
+        PoolWorker * worker = malloc(sizeof(PoolWorker));
+        if (worker != NULL) *worker = (PoolWorker) { pool, i };
+        if (worker == NULL || pthread_create(&pool->threads[i], NULL, pool_worker, worker) != 0) {
+            log_error("Could not start pool worker %zu", i);
+            free(worker);
+            pool_release(pool, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool pool_submit(Pool * pool, PoolFn fn, void * arg)
+{
+    // Counted as queued before it is visible: a worker that takes it right away must not see queued == 0 and
+    // decrement it below zero
+    size_t target;
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pool->queued++;
+    target = current_pool == pool ? current_worker : pool->next++ % pool->workers;
+    pthread_mutex_unlock(&pool->lock);
+
+    const bool pushed = deque_push(&pool->deques[target], (PoolTask) { fn, arg });
+
+    pthread_mutex_lock(&pool->lock);
+    if (pushed) {
+        pthread_cond_signal(&pool->wake);
+    } else {
+        pool->queued--;
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (! pushed) log_error("Could not grow the pool deque, task not submitted");
+    return pushed;
+}
+
+void pool_wait(Pool * pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_free(Pool * pool)
+{
+    if (pool->workers == 0) return;
+    pool_wait(pool);
+    pool_release(pool, pool->workers);
+}
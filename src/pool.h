@@ -0,0 +1,58 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Task entry point, worker is the index of the thread running it (use it for per worker scratch)
+typedef void (*PoolFn)(void * arg, size_t worker);
+
+typedef struct {
+    PoolFn fn;
+    void * arg;
+} PoolTask;
+
+// Per worker double ended queue: the owner pushes and pops at the tail (newest first, still hot in cache), thieves
+// take from the head (oldest first, usually the biggest leftover work)
+typedef struct {
+    pthread_mutex_t lock;
+    PoolTask * tasks;         // Ring buffer
+    size_t capacity;          // Power of 2
+    size_t head;
+    size_t tail;
+} PoolDeque;
+
+// Work stealing thread pool. Tasks submitted from outside are spread round robin over the workers, tasks submitted
+// from inside a task go to that worker's own deque. Idle workers steal before going to sleep
+typedef struct {
+    size_t workers;
+    pthread_t * threads;
+    PoolDeque * deques;
+
+    pthread_mutex_t lock;     // Guards everything below
+    pthread_cond_t wake;      // Signaled when tasks are queued or on stop
+    pthread_cond_t idle;      // Signaled when pending drops to 0
+    size_t queued;            // Tasks sitting in the deques
+    size_t pending;           // Tasks submitted and not finished yet
+    size_t next;              // Round robin cursor for outside submits
+    bool stop;
+} Pool;
+
+// workers == 0 uses one per online core. Returns false if the threads could not be started
+bool pool_init(Pool * pool, size_t workers);
+
+// Returns false when the task could not be queued (out of memory growing a deque): it will not run. Never runs it
+// inline, a task may use the per worker scratch of the index it runs under
+bool pool_submit(Pool * pool, PoolFn fn, void * arg);
+
+// Block until every submitted task is done (call it from outside the pool)
+void pool_wait(Pool * pool);
+
+// Wait for the tasks, stop and join the workers
+void pool_free(Pool * pool);
+
+// Number of online cores (at least 1)
+size_t pool_cores(void);
+
+#endif // POOL_H_
@@ -0,0 +1,185 @@
+#define _DEFAULT_SOURCE // shm_open, ftruncate
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "publish.h"
+
+// Segment names are "/name", the one given may already have the slash
+static void segment_name(const char * name, char * out, size_t size)
+{
+    snprintf(out, size, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+static PublishSlot * slot_at(const PublishHeader * header, uint64_t frame)
+{
+    const size_t offset = sizeof(PublishHeader) + (size_t) (frame % header->slots) * header->slot_size;
+    return (PublishSlot *) ((unsigned char *) header + offset);
+}
+
+float * publish_levels(PublishSlot * slot)
+{
+    return (float *) (slot + 1);
+}
+
+bool publish_open(Publisher * pub, const char * name, uint32_t max_bands)
+{
+    memset(pub, 0, sizeof(*pub));
+    pub->fd = -1;
+    segment_name(name, pub->name, sizeof(pub->name));
+
+    const size_t levels = (max_bands * sizeof(float) + 63) & ~(size_t) 63;
+    const uint32_t slot_size = (uint32_t) (sizeof(PublishSlot) + levels);
+    pub->size = sizeof(PublishHeader) + (size_t) PUBLISH_SLOTS * slot_size;
+
+    pub->fd = shm_open(pub->name, O_CREAT | O_RDWR, 0644);
+    if (pub->fd < 0 || ftruncate(pub->fd, pub->size) != 0) {
+        log_error("Could not create the shared memory segment %s", pub->name);
+        publish_close(pub);
+        return false;
+    }
+    void * map = mmap(NULL, pub->size, PROT_READ | PROT_WRITE, MAP_SHARED, pub->fd, 0);
+    if (map == MAP_FAILED) {
+        log_error("Could not map the shared memory segment %s", pub->name);
+        publish_close(pub);
+        return false;
+    }
+
+    // A segment left behind by a publisher that crashed is taken over from scratch. The magic goes in last, readers
+    // that attach before it is there see a segment that is not ready yet
+    memset(map, 0, pub->size);
+    pub->header = map;
+    pub->header->version = PUBLISH_VERSION;
+    pub->header->slots = PUBLISH_SLOTS;
+    pub->header->max_bands = max_bands;
+    pub->header->slot_size = slot_size;
+    pub->header->pid = (uint32_t) getpid();
+    __atomic_store_n(&pub->header->magic, PUBLISH_MAGIC, __ATOMIC_RELEASE);
+
+    log_info("publishing spectrum frames to shared memory %s (%u bands, %zu bytes)", pub->name, max_bands, pub->size);
+    return true;
+}
+
+PublishSlot * publish_begin(Publisher * pub)
+{
+    const uint64_t frame = pub->frames + 1;
+    PublishSlot * slot = slot_at(pub->header, frame);
+
+    // Odd: readers that copy from here on throw their copy away. The fence keeps every store below after this one
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->frame = frame;
+    return slot;
+}
+
+void publish_end(Publisher * pub, PublishSlot * slot)
+{
+    if (slot->bands > pub->header->max_bands) slot->bands = pub->header->max_bands;
+
+    // Even again once everything above is visible, then announced as the latest
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+    pub->frames = slot->frame;
+    __atomic_store_n(&pub->header->frame, slot->frame, __ATOMIC_RELEASE);
+}
+
+void publish_frame(Publisher * pub, const float * bands_db, size_t bands, const Normalizer * norm, size_t position,
+                   unsigned int rate, const Onset * onset)
+{
+    if (bands > pub->header->max_bands) bands = pub->header->max_bands;
+
+    PublishSlot * slot = publish_begin(pub);
+    float * levels = publish_levels(slot);
+    for (size_t i = 0; i < bands; i++) levels[i] = norm_apply(norm, bands_db[i]);
+    slot->position = position;
+    slot->sample_rate = rate;
+    slot->bands = (uint32_t) bands;
+    slot->bpm = onset->bpm;
+    slot->beat_phase = onset->beat_phase;
+    slot->onset_strength = onset->strength;
+    publish_end(pub, slot);
+}
+
+void publish_close(Publisher * pub)
+{
+    if (pub->header != NULL) {
+        log_info("published %llu spectrum frames to %s", (unsigned long long) pub->frames, pub->name);
+        munmap(pub->header, pub->size);
+    }
+    if (pub->fd >= 0) {
+        close(pub->fd);
+        shm_unlink(pub->name);
+    }
+    memset(pub, 0, sizeof(*pub));
+    pub->fd = -1;
+}
+
+bool publish_attach(PublishReader * reader, const char * name)
+{
+    char path[PUBLISH_NAME_MAX];
+    segment_name(name, path, sizeof(path));
+    memset(reader, 0, sizeof(*reader));
+
+    struct stat st;
+    reader->fd = shm_open(path, O_RDONLY, 0);
+    if (reader->fd < 0 || fstat(reader->fd, &st) != 0 || (size_t) st.st_size < sizeof(PublishHeader)) {
+        publish_detach(reader);
+        return false;
+    }
+    reader->size = (size_t) st.st_size;
+
+    void * map = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (map == MAP_FAILED) {
+        publish_detach(reader);
+        return false;
+    }
+    reader->header = map;
+
+    const PublishHeader * h = reader->header;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != PUBLISH_MAGIC || h->version != PUBLISH_VERSION ||
+        sizeof(PublishHeader) + (size_t) h->slots * h->slot_size > reader->size) {
+        publish_detach(reader);
+        return false;
+    }
+    return true;
+}
+
+bool publish_read(PublishReader * reader, PublishSlot * slot, float * levels, uint32_t max_bands)
+{
+    const PublishHeader * h = reader->header;
+    for (int tries = 0; tries < PUBLISH_READ_TRIES; tries++) {
+        const uint64_t frame = __atomic_load_n(&h->frame, __ATOMIC_ACQUIRE);
+        if (frame == 0 || frame == reader->frame) return false;
+
+        PublishSlot * src = slot_at(h, frame);
+        const uint64_t seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0) {
+            memcpy(slot, src, sizeof(*slot));
+            uint32_t bands = slot->bands < max_bands ? slot->bands : max_bands;
+            if (bands > h->max_bands) bands = h->max_bands;
+            memcpy(levels, publish_levels(src), bands * sizeof(float));
+
+            // The copy counts only if the publisher did not enter the slot meanwhile
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) == seq) {
+                slot->bands = bands;
+                reader->frame = slot->frame;
+                return true;
+            }
+        }
+        reader->retries++; // Lapped by the publisher: start over from the latest frame
+    }
+    return false; // Publisher died inside the slot
+}
+
+void publish_detach(PublishReader * reader)
+{
+    if (reader->header != NULL) munmap((void *) reader->header, reader->size);
+    if (reader->fd >= 0) close(reader->fd);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
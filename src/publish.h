@@ -0,0 +1,90 @@
+#ifndef PUBLISH_H_
+#define PUBLISH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "normalize.h"
+#include "onset.h"
+
+#define PUBLISH_MAGIC 0x50535A4D // "MZSP"
+#define PUBLISH_VERSION 1
+#define PUBLISH_SLOTS 16         // Frames kept: a reader only retries when it falls this far behind mid copy
+#define PUBLISH_NAME_MAX 64
+#define PUBLISH_READ_TRIES 1000  // publish_read() gives up after this many torn copies in a row
+
+// Shared memory layout: header, then PUBLISH_SLOTS slots of slot_size bytes. Every field is written by the
+// publisher only, readers map it read only and never take a lock
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t max_bands;          // Capacity of the levels of a slot
+    uint32_t slot_size;          // Bytes from one slot to the next (slot fields, then the levels)
+    uint32_t pid;                // Publisher process
+    uint64_t frame;              // Last finished frame counter (0: none yet), stored with release
+} __attribute__((aligned(64))) PublishHeader;
+
+// One spectrum frame, followed by float levels[max_bands]. The sequence number is odd while the publisher is in the
+// slot: a reader copies what it needs between two reads of seq and keeps the copy only if both are the same even value
+typedef struct {
+    uint64_t seq;
+    uint64_t frame;              // Frame counter, frame k lives in slot k % slots
+    uint64_t position;           // Stream position (frames) the analysis window ended at
+    uint32_t sample_rate;        // Of position
+    uint32_t bands;              // Levels in this frame (<= max_bands)
+    float bpm;                   // 0 until the tracker has an estimate
+    float beat_phase;            // [0, 1), 0 on the beat
+    float onset_strength;        // Spectral flux
+} __attribute__((aligned(64))) PublishSlot;
+
+// Writer: the render thread (or headless mode) after each analysis frame
+typedef struct {
+    char name[PUBLISH_NAME_MAX];
+    int fd;
+    size_t size;
+    PublishHeader * header;      // Mapped read/write, NULL while closed
+    uint64_t frames;             // Published so far
+} Publisher;
+
+// Reader: any local process
+typedef struct {
+    int fd;
+    size_t size;
+    const PublishHeader * header; // Mapped read only
+    uint64_t frame;              // Last frame returned by publish_read()
+    uint64_t retries;            // Copies thrown away because the slot changed under them
+} PublishReader;
+
+// Create (or take over) the segment /name with room for max_bands levels per frame
+bool publish_open(Publisher * pub, const char * name, uint32_t max_bands);
+
+// Slot of the next frame, marked as being written. Fill its fields and publish_levels(), then publish_end()
+PublishSlot * publish_begin(Publisher * pub);
+
+// Make the slot from publish_begin() the latest frame
+void publish_end(Publisher * pub, PublishSlot * slot);
+
+// One whole frame: the band levels (dBFS) mapped to bar heights through norm, capped at max_bands, the stream
+// position (frames at rate) the analysis window ended at and the tempo of onset. Every producer goes through here so
+// a new slot field is filled in one place
+void publish_frame(Publisher * pub, const float * bands_db, size_t bands, const Normalizer * norm, size_t position,
+                   unsigned int rate, const Onset * onset);
+
+// Unmap and remove the segment
+void publish_close(Publisher * pub);
+
+// Levels of a slot (max_bands floats, the first bands are valid), the bars as drawn: heights in [0, 1]
+float * publish_levels(PublishSlot * slot);
+
+// Map the segment /name read only
+bool publish_attach(PublishReader * reader, const char * name);
+
+// Copy the latest frame and its levels (up to max_bands) if it is newer than the last one read. False when there
+// is nothing new. Never blocks the publisher
+bool publish_read(PublishReader * reader, PublishSlot * slot, float * levels, uint32_t max_bands);
+
+void publish_detach(PublishReader * reader);
+
+#endif // PUBLISH_H_
@@ -0,0 +1,217 @@
+#include <math.h>
+#include <raylib.h>
+
+#include "arena.h"
+#include "clock.h"
+#include "fastmath.h"
+#include "fft.h"
+#include "logger.h"
+#include "png.h"
+#include "pool.h"
+#include "render.h"
+#include "spectrogram.h"
+
+// Per worker scratch, a plan and its batch run on one thread at a time
+typedef struct {
+    FftPlan plan;
+    FftBatch batch;
+    float * frames;               // FFT_BATCH_LANES windowed frames of RENDER_N
+    float complex * spectra;      // Their spectra
+} RenderWorker;
+
+// Everything the tasks read, filled before the first one is submitted
+typedef struct {
+    const float * samples;        // Interleaved, as decoded
+    unsigned int channels;
+    size_t columns;               // Image width, one per hop
+    const float * window;         // Hann (RENDER_N)
+    size_t first[RENDER_ROWS];    // Bins [first, last] of each row, row 0 at the bottom
+    size_t last[RENDER_ROWS];
+    Color lut[256];
+    float full_scale_db;          // Level of a full scale sine through the Hann window
+    unsigned char * pixels;       // RGB, columns x RENDER_ROWS, row 0 of the image at the top
+    RenderWorker * workers;
+} Render;
+
+// Columns [begin, begin + RENDER_BLOCK)
+typedef struct {
+    const Render * render;
+    size_t begin;
+} RenderTask;
+
+// Rows grow geometrically from bin 1 to N/2. The lowest ones are narrower than a bin and repeat it
+static void row_bins(Render * render)
+{
+    const float top = (float) (RENDER_N / 2);
+    for (size_t row = 0; row < RENDER_ROWS; row++) {
+        size_t first = (size_t) powf(top, (float) row / RENDER_ROWS);
+        size_t last = (size_t) powf(top, (float) (row + 1) / RENDER_ROWS);
+        if (first < 1) first = 1;
+        if (last > first) last--;
+        if (row == RENDER_ROWS - 1) last = RENDER_N / 2;
+        render->first[row] = first;
+        render->last[row] = last < first ? first : last;
+    }
+}
+
+// Loudest bin of every row, through the color table into column col of the image
+static void render_column(const Render * render, const float complex * spectrum, size_t col)
+{
+    const size_t pitch = render->columns * 3;
+    unsigned char * pixel = render->pixels + (RENDER_ROWS - 1) * pitch + col * 3;
+    for (size_t row = 0; row < RENDER_ROWS; row++, pixel -= pitch) {
+        float max_power = 0.0f;
+        for (size_t q = render->first[row]; q <= render->last[row]; q++) {
+            const float power = cmag2f(spectrum[q]);
+            if (power > max_power) max_power = power;
+        }
+        const float db = fast_power_db(max_power) - render->full_scale_db;
+        float t = (db - RENDER_FLOOR_DB) / -RENDER_FLOOR_DB;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+        const Color color = render->lut[(int) (t * 255.0f)];
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+    }
+}
+
+static void render_block(void * arg, size_t worker)
+{
+    const RenderTask * task = arg;
+    const Render * render = task->render;
+    RenderWorker * w = &render->workers[worker];
+    const size_t end = task->begin + RENDER_BLOCK < render->columns ? task->begin + RENDER_BLOCK : render->columns;
+    const unsigned int channels = render->channels;
+
+    for (size_t col = task->begin; col < end; col += FFT_BATCH_LANES) {
+        const size_t count = end - col < FFT_BATCH_LANES ? end - col : FFT_BATCH_LANES;
+        for (size_t f = 0; f < count; f++) {
+            const float * x = render->samples + (col + f) * RENDER_HOP * channels;
+            float * frame = w->frames + f * RENDER_N;
+            for (size_t i = 0; i < RENDER_N; i++) {
+                float sum = 0.0f;
+                for (unsigned int c = 0; c < channels; c++) sum += x[i * channels + c];
+                frame[i] = sum / channels * render->window[i];
+            }
+        }
+        fft_batch_real(&w->batch, w->frames, count, w->spectra);
+        for (size_t f = 0; f < count; f++) render_column(render, w->spectra + f * RENDER_N, col + f);
+    }
+}
+
+int render_spectrogram(const char * out_path, const char * track_path)
+{
+    SetTraceLogLevel(LOG_WARNING); // Raylib logs the decode and the export otherwise
+
+    double start = clock_seconds();
+    Wave wave = LoadWave(track_path);
+    if (! IsWaveReady(wave)) {
+        log_error("Could not decode: %s", track_path);
+        return 1;
+    }
+    float * samples = LoadWaveSamples(wave);
+    const size_t frames = wave.frameCount;
+    const unsigned int sample_rate = wave.sampleRate;
+    Render render = { .samples = samples, .channels = wave.channels };
+    UnloadWave(wave);
+    if (samples == NULL) {
+        log_error("Out of memory decoding: %s", track_path);
+        return 1;
+    }
+    if (frames < RENDER_N) {
+        log_error("Track shorter than one window (%zu frames): %s", RENDER_N, track_path);
+        UnloadWaveSamples(samples);
+        return 1;
+    }
+    const double decoded = clock_seconds() - start;
+
+    Pool pool;
+    if (! pool_init(&pool, 0)) {
+        log_error("Could not start the thread pool");
+        UnloadWaveSamples(samples);
+        return 1;
+    }
+
+    render.columns = (frames - RENDER_N) / RENDER_HOP + 1;
+    const size_t tasks_count = (render.columns + RENDER_BLOCK - 1) / RENDER_BLOCK;
+    const size_t worker_size = fft_plan_arena_size(RENDER_N) + fft_batch_arena_size(RENDER_N)
+                             + ARENA_ALIGN(FFT_BATCH_LANES * RENDER_N * sizeof(float))           // frames
+                             + ARENA_ALIGN(FFT_BATCH_LANES * RENDER_N * sizeof(float complex));  // spectra
+    const size_t capacity = ARENA_ALIGN(RENDER_N * sizeof(float))                               // window
+                          + ARENA_ALIGN(render.columns * RENDER_ROWS * 3)                       // pixels
+                          + ARENA_ALIGN(pool.workers * sizeof(RenderWorker))
+                          + pool.workers * worker_size
+                          + ARENA_ALIGN(tasks_count * sizeof(RenderTask));
+
+    Arena arena = { 0 };
+    float * window = NULL;
+    RenderTask * tasks = NULL;
+    bool ok = arena_reserve(&arena, capacity) &&
+              (window = arena_alloc(&arena, RENDER_N * sizeof(float))) != NULL &&
+              (render.pixels = arena_alloc(&arena, render.columns * RENDER_ROWS * 3)) != NULL &&
+              (render.workers = arena_alloc(&arena, pool.workers * sizeof(RenderWorker))) != NULL &&
+              (tasks = arena_alloc(&arena, tasks_count * sizeof(RenderTask))) != NULL;
+    for (size_t w = 0; ok && w < pool.workers; w++) {
+        RenderWorker * worker = &render.workers[w];
+        ok = fft_plan_init(&worker->plan, &arena, RENDER_N) &&
+             fft_batch_init(&worker->batch, &arena, &worker->plan) &&
+             (worker->frames = arena_alloc(&arena, FFT_BATCH_LANES * RENDER_N * sizeof(float))) != NULL &&
+             (worker->spectra = arena_alloc(&arena, FFT_BATCH_LANES * RENDER_N * sizeof(float complex))) != NULL;
+    }
+    if (! ok) {
+        log_error("Out of memory for a %zu x %d spectrogram", render.columns, RENDER_ROWS);
+        pool_free(&pool);
+        arena_free(&arena);
+        UnloadWaveSamples(samples);
+        return 1;
+    }
+
+    fast_hann(window, RENDER_N);
+    render.window = window;
+    render.full_scale_db = 10.0f * log10f((float) RENDER_N * RENDER_N / 16.0f);
+    spectrogram_lut(render.lut);
+    row_bins(&render);
+
+    start = clock_seconds();
+    for (size_t t = 0; t < tasks_count; t++) {
+        tasks[t] = (RenderTask) { &render, t * RENDER_BLOCK };
+        if (! pool_submit(&pool, render_block, &tasks[t])) ok = false;
+    }
+    pool_wait(&pool);
+    const double analyzed = clock_seconds() - start;
+    const size_t workers = pool.workers;
+    UnloadWaveSamples(samples);
+    if (! ok) {
+        log_error("Some columns could not be rendered: %s", track_path);
+        pool_free(&pool);
+        arena_free(&arena);
+        return 1;
+    }
+
+    // PNG on the pool (see png.h), raylib's single threaded encoder for the other formats
+    start = clock_seconds();
+    if (IsFileExtension(out_path, ".png")) {
+        ok = png_write(out_path, render.pixels, render.columns, RENDER_ROWS, &pool);
+    } else {
+        const Image image = {
+            .data = render.pixels,
+            .width = (int) render.columns,
+            .height = RENDER_ROWS,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8,
+        };
+        ok = ExportImage(image, out_path);
+    }
+    const double encoded = clock_seconds() - start;
+    pool_free(&pool);
+    arena_free(&arena);
+    if (! ok) {
+        log_error("Could not write: %s", out_path);
+        return 1;
+    }
+
+    log_info("spectrogram: %.1f s of audio, %zu x %d px, decode %.2f s, analysis %.2f s on %zu workers, encode %.2f s",
+             (double) frames / sample_rate, render.columns, RENDER_ROWS, decoded, analyzed, workers, encoded);
+    return 0;
+}
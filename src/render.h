@@ -0,0 +1,20 @@
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include <stddef.h>
+
+#define RENDER_N ((size_t) 4096)  // FFT size of a column
+#define RENDER_HOP (RENDER_N / 4) // 75% overlap: one column every 1024 frames
+#define RENDER_ROWS 1024          // Log spaced frequency rows, bin 1 at the bottom to N/2 at the top
+#define RENDER_BLOCK 64           // Columns per pool task
+#define RENDER_FLOOR_DB -90.0f    // Darkest color, 0 dBFS is the brightest
+
+// Full track spectrogram as an image for cataloguing and QA: $ musializer --spectrogram <out.png> <file>
+// The track is decoded once, then blocks of columns go to a work stealing pool (one worker per core). Each worker
+// windows FFT_BATCH_LANES frames at a time from the decoded samples, transforms them in one batch (see fft.h) and
+// writes the columns straight into the preallocated RGB image through the color table of the live spectrogram. A .png
+// is encoded on the same pool (png.h), any other extension raylib supports goes through ExportImage. Returns the
+// process exit code
+int render_spectrogram(const char * out_path, const char * track_path);
+
+#endif // RENDER_H_
@@ -0,0 +1,189 @@
+#include <assert.h>
+#include <math.h>
+
+#include "fastmath.h"
+#include "sixstep.h"
+
+// Largest divisor of n not above sqrt(n) (1 for primes: a single row, no parallelism)
+static size_t split(size_t n)
+{
+    size_t best = 1;
+    for (size_t d = 2; d * d <= n; d++) {
+        if (n % d == 0) best = d;
+    }
+    return best;
+}
+
+// Complex values of worker scratch: a gathered block of rows and their transforms
+static size_t scratch_size(size_t n1, size_t n2)
+{
+    return 2 * SIXSTEP_BLOCK * (n1 > n2 ? n1 : n2);
+}
+
+size_t sixstep_arena_size(size_t n, size_t workers)
+{
+    const size_t n1 = split(n);
+    const size_t n2 = n / n1;
+    return 2 * ARENA_ALIGN(workers * sizeof(FftPlan))                      // plans1, plans2
+         + workers * (fft_plan_arena_size(n1) + fft_plan_arena_size(n2))
+         + ARENA_ALIGN(n2 * sizeof(float complex))                          // tw_lo
+         + ARENA_ALIGN(n1 * sizeof(float complex))                          // tw_hi
+         + ARENA_ALIGN(n * sizeof(float complex))                           // work
+         + workers * ARENA_ALIGN(scratch_size(n1, n2) * sizeof(float complex))
+         + ARENA_ALIGN(workers * sizeof(float complex *))                   // scratch
+         + ARENA_ALIGN(workers * SIXSTEP_TASKS_PER_WORKER * sizeof(SixStepTask));
+}
+
+bool sixstep_init(SixStep * fft, Arena * arena, size_t n, Pool * pool)
+{
+    const double pi = 3.14159265358979323846;
+    assert(n > 0);
+
+    const size_t workers = pool->workers;
+    *fft = (SixStep) { .n = n, .n1 = split(n), .pool = pool };
+    fft->n2 = n / fft->n1;
+    fft->plans1 = (FftPlan *) arena_alloc(arena, workers * sizeof(FftPlan));
+    fft->plans2 = (FftPlan *) arena_alloc(arena, workers * sizeof(FftPlan));
+    fft->tw_lo = (float complex *) arena_alloc(arena, fft->n2 * sizeof(float complex));
+    fft->tw_hi = (float complex *) arena_alloc(arena, fft->n1 * sizeof(float complex));
+    fft->work = (float complex *) arena_alloc(arena, n * sizeof(float complex));
+    fft->scratch = (float complex **) arena_alloc(arena, workers * sizeof(float complex *));
+    fft->task_count = workers * SIXSTEP_TASKS_PER_WORKER;
+    fft->tasks = (SixStepTask *) arena_alloc(arena, fft->task_count * sizeof(SixStepTask));
+    if (fft->plans1 == NULL || fft->plans2 == NULL || fft->tw_lo == NULL || fft->tw_hi == NULL ||
+        fft->work == NULL || fft->scratch == NULL || fft->tasks == NULL) {
+        return false;
+    }
+
+    for (size_t w = 0; w < workers; w++) {
+        fft->scratch[w] = (float complex *) arena_alloc(arena, scratch_size(fft->n1, fft->n2) * sizeof(float complex));
+        if (fft->scratch[w] == NULL || ! fft_plan_init(&fft->plans1[w], arena, fft->n1) ||
+            ! fft_plan_init(&fft->plans2[w], arena, fft->n2)) {
+            return false;
+        }
+    }
+
+    // Two short tables instead of the n twiddles of step 2, each entry exact in double
+    for (size_t r = 0; r < fft->n2; r++) {
+        const double angle = -2.0 * pi * (double) r / (double) n;
+        fft->tw_lo[r] = (float) cos(angle) + (float) sin(angle) * I;
+    }
+    for (size_t q = 0; q < fft->n1; q++) {
+        const double angle = -2.0 * pi * (double) (q * fft->n2) / (double) n;
+        fft->tw_hi[q] = (float) cos(angle) + (float) sin(angle) * I;
+    }
+    return true;
+}
+
+// Blocks [begin, end) of j1: steps 1 and 2 of the comment in sixstep.h. Columns j1 of the input come
+// in SIXSTEP_BLOCK at a time (one cache line per input row), are transformed as rows of the scratch and land in
+// work as rows j1, times W_n^(j1 * k2)
+static void columns(void * arg, size_t worker)
+{
+    const SixStepTask * task = arg;
+    const SixStep * fft = task->fft;
+    const size_t n1 = fft->n1, n2 = fft->n2;
+    float complex * gather = fft->scratch[worker];
+
+    for (size_t block = task->begin; block < task->end; block++) {
+        const size_t j0 = block * SIXSTEP_BLOCK;
+        const size_t width = j0 + SIXSTEP_BLOCK < n1 ? SIXSTEP_BLOCK : n1 - j0;
+        for (size_t j2 = 0; j2 < n2; j2++) {
+            if (fft->real_in != NULL) {
+                const float * src = fft->real_in + j0 + n1 * j2;
+                for (size_t c = 0; c < width; c++) gather[c * n2 + j2] = src[c];
+            } else {
+                const float complex * src = fft->in + j0 + n1 * j2;
+                for (size_t c = 0; c < width; c++) gather[c * n2 + j2] = src[c];
+            }
+        }
+
+        for (size_t c = 0; c < width; c++) {
+            const size_t j1 = j0 + c;
+            float complex * row = fft->work + j1 * n2;
+            fft_plan_complex(&fft->plans2[worker], gather + c * n2, row);
+
+            // Exponent j1 * k2 = q * n2 + r walked without a division per element
+            const size_t dq = j1 / n2, dr = j1 % n2;
+            size_t q = 0, r = 0;
+            for (size_t k2 = 1; k2 < n2; k2++) {
+                q += dq;
+                r += dr;
+                if (r >= n2) {
+                    r -= n2;
+                    q++;
+                }
+                row[k2] = cmul(row[k2], cmul(fft->tw_hi[q], fft->tw_lo[r]));
+            }
+        }
+    }
+}
+
+// Blocks [begin, end) of k2: steps 3 to 5. Columns k2 of work are gathered the same way, transformed and scattered
+// back as columns of out (one cache line per output row)
+static void rows(void * arg, size_t worker)
+{
+    const SixStepTask * task = arg;
+    const SixStep * fft = task->fft;
+    const size_t n1 = fft->n1, n2 = fft->n2;
+    float complex * gather = fft->scratch[worker];
+    float complex * spectra = gather + SIXSTEP_BLOCK * n1;
+
+    for (size_t block = task->begin; block < task->end; block++) {
+        const size_t k0 = block * SIXSTEP_BLOCK;
+        const size_t width = k0 + SIXSTEP_BLOCK < n2 ? SIXSTEP_BLOCK : n2 - k0;
+        for (size_t j1 = 0; j1 < n1; j1++) {
+            const float complex * src = fft->work + k0 + n2 * j1;
+            for (size_t c = 0; c < width; c++) gather[c * n1 + j1] = src[c];
+        }
+
+        for (size_t c = 0; c < width; c++) {
+            fft_plan_complex(&fft->plans1[worker], gather + c * n1, spectra + c * n1);
+        }
+
+        for (size_t k1 = 0; k1 < n1; k1++) {
+            float complex * dst = fft->out + k0 + n2 * k1;
+            for (size_t c = 0; c < width; c++) dst[c] = spectra[c * n1 + k1];
+        }
+    }
+}
+
+// Split count slices of a pass over the tasks and wait for all of them (the barrier between the passes). False when
+// a slice could not be submitted, the output is then incomplete
+static bool run(SixStep * fft, PoolFn pass, size_t count)
+{
+    bool ok = true;
+    for (size_t t = 0; t < fft->task_count; t++) {
+        SixStepTask * task = &fft->tasks[t];
+        *task = (SixStepTask) { fft, count * t / fft->task_count, count * (t + 1) / fft->task_count };
+        if (task->begin < task->end && ! pool_submit(fft->pool, pass, task)) ok = false;
+    }
+    pool_wait(fft->pool);
+    return ok;
+}
+
+static size_t blocks(size_t size)
+{
+    return (size + SIXSTEP_BLOCK - 1) / SIXSTEP_BLOCK;
+}
+
+static bool sixstep(SixStep * fft)
+{
+    return run(fft, columns, blocks(fft->n1)) && run(fft, rows, blocks(fft->n2));
+}
+
+bool sixstep_complex(SixStep * fft, const float complex * in, float complex * out)
+{
+    fft->in = in;
+    fft->real_in = NULL;
+    fft->out = out;
+    return sixstep(fft);
+}
+
+bool sixstep_real(SixStep * fft, const float * in, float complex * out)
+{
+    fft->in = NULL;
+    fft->real_in = in;
+    fft->out = out;
+    return sixstep(fft);
+}
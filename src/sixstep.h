@@ -0,0 +1,65 @@
+#ifndef SIXSTEP_H_
+#define SIXSTEP_H_
+
+#include <complex.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "fft.h"
+#include "pool.h"
+
+#define SIXSTEP_BLOCK 8              // Columns gathered at a time: 8 complex are one cache line of each row
+#define SIXSTEP_TASKS_PER_WORKER 4   // Slices of each step per worker, so stealing evens out a slow or busy core
+
+struct SixStep;
+
+// One slice of a pass: blocks of columns [begin, end)
+typedef struct {
+    struct SixStep * fft;
+    size_t begin;
+    size_t end;
+} SixStepTask;
+
+// Transform of a large n (2^18 to 2^22 for offline spectra) on a thread pool. n = n1 * n2 with n1 and n2 close to
+// sqrt(n), and x[j1 + n1 * j2] seen as a matrix:
+//   1. transpose into n1 rows of n2    2. FFT of every row, times W_n^(j1 * k2)    3. transpose into n2 rows of n1
+//   4. FFT of every row                5. transpose into X[k2 + n2 * k1]
+// The transposes are blocked: each worker gathers SIXSTEP_BLOCK columns into its scratch, transforms them there and
+// writes them back a cache line per row, so 1-2 and 3-5 are two passes over memory, split across the workers with
+// a barrier in between. Every row transform is a few KB that stays in L1, where a single plan of this size streams
+// the whole array through L3 once per radix pass
+typedef struct SixStep {
+    size_t n;
+    size_t n1;                       // Outer size, the largest divisor of n not above sqrt(n)
+    size_t n2;                       // n / n1
+    Pool * pool;                     // Not owned
+    FftPlan * plans1;                // One plan of n1 per worker, a plan's buffer belongs to one thread
+    FftPlan * plans2;                // One plan of n2 per worker
+    float complex * tw_lo;           // W_n^r for r in [0, n2)
+    float complex * tw_hi;           // W_n^(q * n2) for q in [0, n1): W_n^(q * n2 + r) = tw_hi[q] * tw_lo[r]
+    float complex * work;            // n, the n1 rows of step 2
+    float complex ** scratch;        // Per worker, 2 * SIXSTEP_BLOCK * max(n1, n2)
+    SixStepTask * tasks;             // workers * SIXSTEP_TASKS_PER_WORKER
+    size_t task_count;
+
+    // Current transform (one at a time)
+    const float complex * in;
+    const float * real_in;           // Instead of in
+    float complex * out;
+} SixStep;
+
+// Arena bytes sixstep_init() needs for n on a pool of workers threads
+size_t sixstep_arena_size(size_t n, size_t workers);
+
+// Split n, plan the rows and fill the tables. Returns false if the arena is too small
+bool sixstep_init(SixStep * fft, Arena * arena, size_t n, Pool * pool);
+
+// Complex transform of n values, out may be in. Blocks until the pool is done: call it from outside the pool, and
+// nothing else may be submitted to the pool meanwhile. Returns false if the pool could not take a pass (out of
+// memory), out is then incomplete
+bool sixstep_complex(SixStep * fft, const float complex * in, float complex * out);
+
+// Transform of n real samples (all n bins)
+bool sixstep_real(SixStep * fft, const float * in, float complex * out);
+
+#endif // SIXSTEP_H_
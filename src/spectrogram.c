@@ -0,0 +1,93 @@
+#include <string.h>
+
+#include "spectrogram.h"
+
+void spectrogram_lut(Color lut[256])
+{
+    const Color stops[] = {
+        { 0x23, 0x23, 0x23, 0xFF },
+        { 0x99, 0x00, 0xCC, 0xFF },
+        { 0x66, 0xFF, 0x33, 0xFF },
+        { 0xFF, 0xFF, 0xFF, 0xFF },
+    };
+    const int segments = sizeof(stops) / sizeof(stops[0]) - 1;
+
+    for (int i = 0; i < 256; i++) {
+        const float t = (float) i / 255 * segments;
+        int s = (int) t;
+        if (s >= segments) s = segments - 1;
+        const float f = t - s;
+        const Color a = stops[s];
+        const Color b = stops[s + 1];
+        lut[i] = (Color) {
+            (unsigned char) (a.r + (b.r - a.r) * f),
+            (unsigned char) (a.g + (b.g - a.g) * f),
+            (unsigned char) (a.b + (b.b - a.b) * f),
+            0xFF,
+        };
+    }
+}
+
+void spectrogram_init(Spectrogram * sg, int columns)
+{
+    spectrogram_lut(sg->lut);
+    sg->columns = columns;
+    sg->head = 0;
+
+    Image image = GenImageColor(columns, SPECTROGRAM_ROWS, sg->lut[0]);
+    sg->texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+}
+
+void spectrogram_push(Spectrogram * sg, const float * bands_db, size_t m, const Normalizer * norm)
+{
+    if (m == 0) return;
+
+    // Rows interpolate between the (already log spaced) bands, row 0 is the top of the texture
+    const float scale = (float) (m - 1) / (SPECTROGRAM_ROWS - 1);
+    for (int row = 0; row < SPECTROGRAM_ROWS; row++) {
+        const float pos = (SPECTROGRAM_ROWS - 1 - row) * scale;
+        size_t band = (size_t) pos;
+        if (band >= m - 1) band = m > 1 ? m - 2 : 0;
+        const float frac = m > 1 ? pos - band : 0.0f;
+
+        const float a = norm_apply(norm, bands_db[band]);
+        const float b = m > 1 ? norm_apply(norm, bands_db[band + 1]) : a;
+        sg->column[row] = sg->lut[(int) ((a + (b - a) * frac) * 255.0f)];
+    }
+
+    UpdateTextureRec(sg->texture, (Rectangle) { sg->head, 0, 1, SPECTROGRAM_ROWS }, sg->column);
+    sg->head = (sg->head + 1) % sg->columns;
+}
+
+void spectrogram_draw(const Spectrogram * sg, Rectangle dest)
+{
+    // [head, columns) is the oldest part and goes to the left, [0, head) follows it
+    const float older = (float) (sg->columns - sg->head);
+    const float column_width = dest.width / sg->columns;
+
+    const Rectangle src_old = { sg->head, 0, older, SPECTROGRAM_ROWS };
+    const Rectangle dst_old = { dest.x, dest.y, older * column_width, dest.height };
+    DrawTexturePro(sg->texture, src_old, dst_old, (Vector2) { 0, 0 }, 0.0f, WHITE);
+
+    if (sg->head > 0) {
+        const Rectangle src_new = { 0, 0, sg->head, SPECTROGRAM_ROWS };
+        const Rectangle dst_new = { dest.x + dst_old.width, dest.y, sg->head * column_width, dest.height };
+        DrawTexturePro(sg->texture, src_new, dst_new, (Vector2) { 0, 0 }, 0.0f, WHITE);
+    }
+}
+
+void spectrogram_clear(Spectrogram * sg)
+{
+    // One upload of the whole texture, the same blank image spectrogram_init() starts from
+    Image image = GenImageColor(sg->columns, SPECTROGRAM_ROWS, sg->lut[0]);
+    if (image.data != NULL) UpdateTexture(sg->texture, image.data);
+    UnloadImage(image);
+    sg->head = 0;
+}
+
+void spectrogram_unload(Spectrogram * sg)
+{
+    UnloadTexture(sg->texture);
+    memset(sg, 0, sizeof(*sg));
+}
@@ -0,0 +1,38 @@
+#ifndef SPECTROGRAM_H_
+#define SPECTROGRAM_H_
+
+#include <raylib.h>
+#include <stddef.h>
+
+#include "normalize.h"
+
+#define SPECTROGRAM_ROWS 1024 // Frequency resolution of the texture (low frequencies at the bottom)
+
+// Scrolling time/frequency view. The texture is a ring of columns: each analysis frame writes one column at head and
+// uploads only that 1 x SPECTROGRAM_ROWS rectangle. Drawing splits the ring at head so the oldest column is at the
+// left, the history is never redrawn or uploaded again
+typedef struct {
+    Texture2D texture;                // columns x SPECTROGRAM_ROWS
+    int columns;                      // History length (texture width)
+    int head;                         // Column written next, also the oldest one on screen
+    Color lut[256];                   // Level to color
+    Color column[SPECTROGRAM_ROWS];   // Staging pixels for the next upload
+} Spectrogram;
+
+// Level (0..255) to color: dark background -> purple -> green -> white, same palette as the bars
+void spectrogram_lut(Color lut[256]);
+
+// Needs the window (GL context) to be up
+void spectrogram_init(Spectrogram * sg, int columns);
+
+// Write one column from m band levels (dBFS) mapped with the same normalizer used by the bars
+void spectrogram_push(Spectrogram * sg, const float * bands_db, size_t m, const Normalizer * norm);
+
+void spectrogram_draw(const Spectrogram * sg, Rectangle dest);
+
+// Blank the history (new track)
+void spectrogram_clear(Spectrogram * sg);
+
+void spectrogram_unload(Spectrogram * sg);
+
+#endif // SPECTROGRAM_H_
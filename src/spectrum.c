@@ -0,0 +1,132 @@
+#include <math.h>
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "fastmath.h"
+#include "logger.h"
+#include "pool.h"
+#include "sixstep.h"
+#include "spectrum.h"
+
+static bool valid_size(size_t n)
+{
+    return n >= ((size_t) 1 << SPECTRUM_MIN_LOG2) && n <= ((size_t) 1 << SPECTRUM_MAX_LOG2) && (n & (n - 1)) == 0;
+}
+
+// Mono mix of the whole track, NULL when it cannot be decoded
+static float * decode_mono(const char * track_path, size_t * frames, unsigned int * sample_rate)
+{
+    Wave wave = LoadWave(track_path);
+    if (! IsWaveReady(wave)) {
+        log_error("Could not decode: %s", track_path);
+        return NULL;
+    }
+    float * samples = LoadWaveSamples(wave);
+    const unsigned int channels = wave.channels;
+    *frames = wave.frameCount;
+    *sample_rate = wave.sampleRate;
+    UnloadWave(wave);
+
+    float * mono = samples != NULL ? malloc(*frames * sizeof(float)) : NULL;
+    if (mono == NULL) {
+        log_error("Out of memory decoding: %s", track_path);
+    } else {
+        for (size_t i = 0; i < *frames; i++) {
+            float sum = 0.0f;
+            for (unsigned int c = 0; c < channels; c++) sum += samples[i * channels + c];
+            mono[i] = sum / channels;
+        }
+    }
+    if (samples != NULL) UnloadWaveSamples(samples);
+    return mono;
+}
+
+static bool write_spectrum(const char * out_path, const double * power, size_t n, size_t segments,
+                           unsigned int sample_rate)
+{
+    FILE * file = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (file == NULL) return false;
+
+    // Power of a full scale sine through the Hann window is (n / 4)^2 in its bin
+    const double full_scale_db = 10.0 * log10((double) n * n / 16.0);
+    fprintf(file, "# musializer spectrum: N = %zu, %zu segments, %u Hz. <hz> <dBFS>\n", n, segments, sample_rate);
+    for (size_t q = 0; q <= n / 2; q++) {
+        const double db = power[q] > 0.0 ? 10.0 * log10(power[q]) - full_scale_db : SPECTRUM_FLOOR_DB;
+        fprintf(file, "%.4f %.2f\n", (double) q * sample_rate / n, db > SPECTRUM_FLOOR_DB ? db : SPECTRUM_FLOOR_DB);
+    }
+
+    bool ok = ! ferror(file);
+    if (file == stdout) {
+        ok = fflush(stdout) == 0 && ok;
+    } else {
+        ok = fclose(file) == 0 && ok;
+    }
+    return ok;
+}
+
+int spectrum_run(const char * out_path, const char * track_path, size_t n)
+{
+    if (! valid_size(n)) {
+        log_error("--spectrum N must be a power of two from %zu to %zu", (size_t) 1 << SPECTRUM_MIN_LOG2,
+                  (size_t) 1 << SPECTRUM_MAX_LOG2);
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING); // Raylib logs the decode otherwise
+
+    size_t frames = 0;
+    unsigned int sample_rate = 0;
+    float * mono = decode_mono(track_path, &frames, &sample_rate);
+    if (mono == NULL) return 1;
+
+    Pool pool;
+    if (! pool_init(&pool, 0)) {
+        log_error("Could not start the thread pool");
+        free(mono);
+        return 1;
+    }
+
+    const size_t capacity = sixstep_arena_size(n, pool.workers)
+                          + 2 * ARENA_ALIGN(n * sizeof(float))                 // window, segment
+                          + ARENA_ALIGN(n * sizeof(float complex))             // spectrum
+                          + ARENA_ALIGN((n / 2 + 1) * sizeof(double));         // power
+    Arena arena = { 0 };
+    SixStep six;
+    float * window = NULL;
+    float * segment = NULL;
+    float complex * spectrum = NULL;
+    double * power = NULL;
+    bool ok = arena_reserve(&arena, capacity) && sixstep_init(&six, &arena, n, &pool) &&
+              (window = arena_alloc(&arena, n * sizeof(float))) != NULL &&
+              (segment = arena_alloc(&arena, n * sizeof(float))) != NULL &&
+              (spectrum = arena_alloc(&arena, n * sizeof(float complex))) != NULL &&
+              (power = arena_alloc(&arena, (n / 2 + 1) * sizeof(double))) != NULL;
+    if (! ok) log_error("Out of memory for a spectrum of N = %zu", n);
+    if (ok) fast_hann(window, n);
+
+    // Welch: segments of n every n / 2, or one zero padded segment (the arena is zeroed past the samples)
+    size_t segments = 0;
+    for (size_t pos = 0; ok && (segments == 0 || pos + n <= frames); pos += n / 2, segments++) {
+        const size_t count = frames - pos < n ? frames - pos : n;
+        for (size_t i = 0; i < count; i++) segment[i] = mono[pos + i] * window[i];
+        ok = sixstep_real(&six, segment, spectrum);
+        for (size_t q = 0; ok && q <= n / 2; q++) power[q] += cmag2f(spectrum[q]);
+    }
+    const size_t workers = pool.workers;
+    pool_free(&pool);
+    free(mono);
+
+    if (ok) {
+        for (size_t q = 0; q <= n / 2; q++) power[q] /= (double) segments;
+        ok = write_spectrum(out_path, power, n, segments, sample_rate);
+        if (! ok) log_error("Could not write: %s", out_path);
+    }
+    arena_free(&arena);
+    if (ok) {
+        log_info("spectrum: %.1f s of audio, N = %zu (%.3f Hz per bin), %zu segments on %zu workers",
+                 (double) frames / sample_rate, n, (double) sample_rate / n, segments, workers);
+    }
+    return ok ? 0 : 1;
+}
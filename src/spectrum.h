@@ -0,0 +1,20 @@
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <stddef.h>
+
+#define SPECTRUM_MIN_LOG2 10          // Smallest N (--spectrum 1024)
+#define SPECTRUM_MAX_LOG2 24          // Largest N, 2^24 bins is over 6 minutes of 44.1 kHz per segment
+#define SPECTRUM_FLOOR_DB -200.0f     // Level written for an empty bin
+
+// High resolution long term spectrum of a track for offline mastering checks:
+//   $ musializer --spectrum <N> <out|-> <file>
+// The track is decoded and mixed to mono, then cut into Hann windowed segments of N with 50% overlap (Welch). Each
+// segment is one six-step transform spread over a pool with one worker per core (see sixstep.h), and the power of
+// the segments is averaged per bin. A track shorter than N is one zero padded segment, its levels read low by the
+// padded share of the window. The output is text, one "<hz> <dBFS>" line per bin from 0 to N/2 after a # comment,
+// where 0 dBFS is a full scale sine. N is a power of two in [2^SPECTRUM_MIN_LOG2, 2^SPECTRUM_MAX_LOG2]. Returns the
+// process exit code
+int spectrum_run(const char * out_path, const char * track_path, size_t n);
+
+#endif // SPECTRUM_H_
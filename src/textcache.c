@@ -0,0 +1,124 @@
+#include <math.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "textcache.h"
+
+static void render(CachedText * ct, Font font, float spacing)
+{
+    ct->size = MeasureTextEx(font, ct->text, (float) font.baseSize, spacing);
+    const int width = (int) ceilf(ct->size.x);
+    const int height = (int) ceilf(ct->size.y);
+
+    ct->ready = true;
+    if (width == 0 || height == 0) { // Empty string: nothing to draw
+        text_cache_unload(ct);
+        return;
+    }
+
+    // Same size strings (digits of a timer) reuse the texture
+    if (ct->target.id == 0 || ct->target.texture.width != width || ct->target.texture.height != height) {
+        text_cache_unload(ct);
+        ct->target = LoadRenderTexture(width, height);
+    }
+
+    // Glyphs are composited over the transparent target into premultiplied alpha: color * a + dst * (1 - a) and
+    // a + dst_a * (1 - a). Over is associative in premultiplied form, so blitting the texture with
+    // BLEND_ALPHA_PREMULTIPLY gives the pixels DrawTextEx would, overlapping glyph edges included
+    BeginTextureMode(ct->target);
+    ClearBackground(BLANK);
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD,
+                              RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+    DrawTextEx(font, ct->text, (Vector2) { 0, 0 }, (float) font.baseSize, spacing, ct->color);
+    EndBlendMode();
+    EndTextureMode();
+
+    ct->renders++;
+}
+
+bool text_cache_set(CachedText * ct, Font font, float spacing, const char * text, Color color)
+{
+    const bool same_color = ct->color.r == color.r && ct->color.g == color.g && ct->color.b == color.b &&
+                            ct->color.a == color.a;
+    if (ct->ready && same_color && strcmp(ct->text, text) == 0) return false;
+
+    strncpy(ct->text, text, sizeof(ct->text) - 1);
+    ct->text[sizeof(ct->text) - 1] = '\0';
+    ct->color = color;
+    render(ct, font, spacing);
+    return true;
+}
+
+void text_cache_draw(const CachedText * ct, Vector2 pos)
+{
+    if (ct->target.id == 0) return;
+
+    // Render textures are stored bottom up: negative source height flips them. Whole pixels keep the blit 1:1
+    const Rectangle source = { 0, 0, (float) ct->target.texture.width, (float) -ct->target.texture.height };
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    DrawTextureRec(ct->target.texture, source, (Vector2) { floorf(pos.x), floorf(pos.y) }, WHITE);
+    EndBlendMode();
+}
+
+void text_cache_draw_centered(const CachedText * ct, Vector2 center)
+{
+    text_cache_draw(ct, (Vector2) { center.x - ct->size.x / 2, center.y - ct->size.y / 2 });
+}
+
+#ifdef DEV_ENV
+int text_cache_max_error(const CachedText * ct, Font font, float spacing, Color background)
+{
+    if (ct->target.id == 0) return 0;
+
+    const int width = ct->target.texture.width;
+    const int height = ct->target.texture.height;
+    RenderTexture2D immediate = LoadRenderTexture(width, height);
+    RenderTexture2D retained = LoadRenderTexture(width, height);
+
+    BeginTextureMode(immediate);
+    ClearBackground(background);
+    DrawTextEx(font, ct->text, (Vector2) { 0, 0 }, (float) font.baseSize, spacing, ct->color);
+    EndTextureMode();
+
+    BeginTextureMode(retained);
+    ClearBackground(background);
+    text_cache_draw(ct, (Vector2) { 0, 0 });
+    EndTextureMode();
+
+    // Both targets are bottom up, the rows line up without flipping
+    Image a = LoadImageFromTexture(immediate.texture);
+    Image b = LoadImageFromTexture(retained.texture);
+    Color * pa = LoadImageColors(a);
+    Color * pb = LoadImageColors(b);
+    int max_error = 0;
+    for (int i = 0; pa != NULL && pb != NULL && i < width * height; i++) {
+        const int d[4] = { pa[i].r - pb[i].r, pa[i].g - pb[i].g, pa[i].b - pb[i].b, pa[i].a - pb[i].a };
+        for (int c = 0; c < 4; c++) {
+            if (abs(d[c]) > max_error) max_error = abs(d[c]);
+        }
+    }
+    if (pa == NULL || pb == NULL) max_error = -1;
+
+    UnloadImageColors(pa);
+    UnloadImageColors(pb);
+    UnloadImage(a);
+    UnloadImage(b);
+    UnloadRenderTexture(immediate);
+    UnloadRenderTexture(retained);
+    return max_error;
+}
+#endif
+
+void text_cache_invalidate(CachedText * ct)
+{
+    text_cache_unload(ct);
+    ct->ready = false;
+}
+
+void text_cache_unload(CachedText * ct)
+{
+    if (ct->target.id != 0) UnloadRenderTexture(ct->target);
+    ct->target = (RenderTexture2D) { 0 };
+}
@@ -0,0 +1,42 @@
+#ifndef TEXTCACHE_H_
+#define TEXTCACHE_H_
+
+#include <raylib.h>
+#include <stdbool.h>
+
+#define TEXT_CACHE_MAX 128 // Longest cached string (bytes, with the terminator)
+
+// Retained UI string: measured and rasterized once into its own render texture, then drawn as a single quad every
+// frame until the content changes. Strings that change a few times per second (time, volume, tempo) pay one
+// rasterization per change instead of one glyph layout per frame
+typedef struct {
+    char text[TEXT_CACHE_MAX];        // Content of the texture
+    Vector2 size;                     // MeasureTextEx of text (what centering needs)
+    RenderTexture2D target;           // Exactly size (rounded up), premultiplied alpha
+    Color color;
+    bool ready;                       // text, size and target agree
+    unsigned int renders;             // Rasterizations so far (dev stats)
+} CachedText;
+
+// Set the content. Measures and re-renders only when text or color changed, returns true when it did.
+// Needs the window (GL context) to be up
+bool text_cache_set(CachedText * ct, Font font, float spacing, const char * text, Color color);
+
+// Blit with BLEND_ALPHA_PREMULTIPLY, the same pixels as DrawTextEx at pos
+void text_cache_draw(const CachedText * ct, Vector2 pos);
+
+// Draw with the center of the text at center
+void text_cache_draw_centered(const CachedText * ct, Vector2 center);
+
+#ifdef DEV_ENV
+// Largest channel difference between DrawTextEx and the cached texture drawn over background, -1 if the pixels
+// could not be read back. 0 when the blending is right
+int text_cache_max_error(const CachedText * ct, Font font, float spacing, Color background);
+#endif
+
+// Drop the texture (window size or font change): the next text_cache_set() renders again
+void text_cache_invalidate(CachedText * ct);
+
+void text_cache_unload(CachedText * ct);
+
+#endif // TEXTCACHE_H_